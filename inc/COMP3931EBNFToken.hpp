@@ -18,12 +18,20 @@ namespace ParserGenerator {
             GROUP
         };
 
-        EBNFToken(TokenType type, std::string value);
+        EBNFToken(TokenType type, std::string value, int symbol_id = -1);
         ~EBNFToken();
 
         TokenType get_type();
         std::string get_value();
 
+        // ID of the terminal or nonterminal in the grammar's SymbolTable. -1 until resolved
+        int get_symbol_id();
+        void set_symbol_id(int new_symbol_id);
+
+        // Index of the node compiled from this token in the grammar's GrammarIR. -1 until finalized
+        int get_ir_index();
+        void set_ir_index(int new_ir_index);
+
         void add_child(EBNFToken* new_child);
         std::vector<EBNFToken*>& get_children();
 
@@ -32,6 +40,8 @@ namespace ParserGenerator {
     private:
         TokenType type;
         std::string value;
+        int symbol_id;
+        int ir_index;
         std::vector<EBNFToken*> children;
     };
 } // namespace ParserGenerator
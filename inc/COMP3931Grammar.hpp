@@ -1,13 +1,19 @@
 #ifndef __COMP3931_GRAMMAR_HEADER__
 #define __COMP3931_GRAMMAR_HEADER__
 
+#include <cstdint>
 #include <list>
 #include <set>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "COMP3931EBNFToken.hpp"
+#include "COMP3931GrammarIR.hpp"
+#include "COMP3931InputBuffer.hpp"
+#include "COMP3931SymbolSet.hpp"
+#include "COMP3931SymbolTable.hpp"
 
 namespace ParserGenerator {
 
@@ -18,6 +24,13 @@ namespace ParserGenerator {
         ~Grammar();
 
         bool input_language_from_file(std::string file_path);
+        // Read a grammar from text in memory, in the same format as a grammar file
+        bool input_language_from_string(std::string_view contents);
+        // Read a grammar file and finalize it, unless the binary cache beside it (file_path + ".cache") was written from
+        // the same contents. That is loaded instead, already finalized, skipping the parsing and the First and Follow
+        // set calculations. Otherwise the cache is written for next time. The grammar must not have been added to yet.
+        // False if the file cannot be read, has errors or cannot be finalized
+        bool input_finalized_language(std::string file_path, bool use_cache = true);
 
         bool add_terminal(std::string new_terminal);
         std::set<std::string>& get_terminals();
@@ -31,11 +44,16 @@ namespace ParserGenerator {
         bool set_start_symbol(std::string new_start_symbol);
         std::string get_start_symbol();
 
-        bool is_terminal(std::string to_find);
-        bool is_nonterminal(std::string to_find);
+        bool is_terminal(std::string_view to_find);
+        bool is_nonterminal(std::string_view to_find);
 
-        // Used to tell the grammar it's not going to change so it can compute the first and follow sets
-        void finalize_grammar();
+        SymbolTable& get_symbol_table();
+        // Compiled form of the productions. Only valid after finalize_grammar()
+        GrammarIR& get_ir();
+
+        // Used to tell the grammar it's not going to change so it can compute the first and follow sets. The grammar is
+        // final afterwards either way, but false if the sets could not all be calculated, e.g. without a start symbol
+        bool finalize_grammar();
         bool get_is_final();
 
         void log_grammar();
@@ -44,38 +62,73 @@ namespace ParserGenerator {
         std::set<std::string> get_first_set(std::string symbol);
         std::set<std::string> get_follow_set(std::string nonterminal);
 
+        // ID based versions of the above. Only valid after finalize_grammar()
+        SymbolSet calculate_first_bits(EBNFToken* ebnf_token);
+        const SymbolSet& get_first_set(int nonterminal_id);
+        const SymbolSet& get_follow_set(int nonterminal_id);
+
+        // Number of IR node First sets calculated by finalize_grammar()
+        int get_first_set_calculations();
+
+        // Statistics from the last Follow set calculation
+        int get_follow_production_visits();
+        int get_follow_visits_saved();
+
+        // Convert a set of terminal IDs back to terminal names
+        std::set<std::string> symbol_set_to_strings(const SymbolSet& symbol_set);
+        std::string symbol_set_to_string(const SymbolSet& symbol_set);
+
     private:
         bool is_final = false;
         std::set<std::string> terminals;
         std::set<std::string> nonterminals;
         std::unordered_map<std::string, EBNFToken*> production_rules;
         std::string start_symbol;
-        std::unordered_map<std::string, std::set<std::string>> first_sets;
-        std::unordered_map<std::string, std::set<std::string>> follow_sets;
+        SymbolTable symbol_table;
+
+        GrammarIR ir;
+
+        // Indexed by nonterminal ID
+        std::vector<SymbolSet> first_sets;
+        std::vector<SymbolSet> follow_sets;
+        int first_set_calculations = 0;
+        int follow_production_visits = 0;
+        int follow_visits_saved = 0;
 
         // Functions to parse a grammar input file
-        bool file_parse_INPUT_FILE(std::ifstream& input);
-        bool file_parse_TERM_DECLAR(std::ifstream& input);
-        bool file_parse_NONTERM_DECLAR(std::ifstream& input);
-        bool file_parse_TERMINAL(std::ifstream& input, std::string& terminal);
-        bool file_parse_GRAM_DECLAR(std::ifstream& input);
-        bool file_parse_PRODUCTION(std::ifstream& input);
-        bool file_parse_LHS(std::ifstream& input, std::string& new_lhs);
-        bool file_parse_RHS(std::ifstream& input, EBNFToken* new_rhs);
-        bool file_parse_TERM(std::ifstream& input, EBNFToken* new_rhs);
-        bool file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs);
-
-        bool file_parse_skip_white_space(std::ifstream& input);
-        bool file_parse_end_of_line(std::ifstream& input);
-        bool file_parse_check_char(std::ifstream& input, char character);
+        bool file_parse_INPUT_FILE(InputBuffer& input);
+        bool file_parse_TERM_DECLAR(InputBuffer& input);
+        bool file_parse_NONTERM_DECLAR(InputBuffer& input);
+        bool file_parse_TERMINAL(InputBuffer& input, std::string_view& terminal);
+        bool file_parse_GRAM_DECLAR(InputBuffer& input);
+        bool file_parse_PRODUCTION(InputBuffer& input);
+        bool file_parse_LHS(InputBuffer& input, std::string_view& new_lhs);
+        bool file_parse_RHS(InputBuffer& input, EBNFToken* new_rhs);
+        bool file_parse_TERM(InputBuffer& input, EBNFToken* new_rhs);
+        bool file_parse_FACTOR(InputBuffer& input, EBNFToken* new_rhs);
+
+        bool file_parse_skip_white_space(InputBuffer& input);
+        bool file_parse_end_of_line(InputBuffer& input);
+        bool file_parse_check_char(InputBuffer& input, char character);
+
+        // Load or save everything finalize_grammar() produces, along with the symbols and start symbol. A cache is only
+        // read if it was written from contents with the same hash, by a build with the same layout
+        bool read_cache(const std::string& cache_path, uint64_t content_hash);
+        bool write_cache(const std::string& cache_path, uint64_t content_hash);
+
+        // Fill in the symbol IDs of any EBNFTokens that were constructed without one
+        bool resolve_symbol_ids(EBNFToken* ebnf_token);
 
         bool calculate_all_first_sets();
         bool calculate_all_follow_sets();
 
         // Calculate the terminals that need to be added to the follow set for a particular nonterminal
-        bool calculate_follow_terminal(std::string production_lhs, EBNFToken* ebnf_token, std::vector<std::set<std::string>>& current_trailers);
-        // Calculate the terminals that need to be added to the first set for a particular nonterminal
-        std::set<std::string> calculate_first_terminal(EBNFToken* ebnf_token);
+        // Nonterminals whose Follow set changed are appended to changed_follow_sets
+        bool calculate_follow_terminal(int node_index, std::vector<SymbolSet>& current_trailers, std::vector<int>& changed_follow_sets);
+        // Find the nonterminals that Follow(lhs) of a production is copied into
+        void calculate_trailing_nonterminals(int node_index, bool& is_trailing, std::vector<int>& trailing_nonterminals);
+        // Calculate the first set of an IR node from the first sets of its children
+        void calculate_first_terminal(int node_index);
     };
 
 } // namespace ParserGenerator
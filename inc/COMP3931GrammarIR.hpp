@@ -0,0 +1,63 @@
+#ifndef __COMP3931_GRAMMARIR_HEADER__
+#define __COMP3931_GRAMMARIR_HEADER__
+
+#include <string>
+#include <vector>
+
+#include "COMP3931EBNFToken.hpp"
+#include "COMP3931SymbolSet.hpp"
+#include "COMP3931SymbolTable.hpp"
+
+namespace ParserGenerator {
+
+    // Compiled form of the EBNF production trees. Every node of every production lives in one vector and refers to its
+    // children by an index range, so the children of a node are always adjacent and always come after the node itself
+    class GrammarIR {
+    public:
+        struct Node {
+            EBNFToken::TokenType type;
+            // Terminal ID for TERMINAL nodes, nonterminal ID for NONTERMINAL nodes, otherwise -1
+            int symbol_id;
+            int first_child;
+            int child_count;
+        };
+
+        GrammarIR();
+
+        // Frees every node of every production
+        void clear();
+
+        // Compile the production tree of a nonterminal. The symbol IDs of the tree must already be resolved
+        int add_production(int nonterminal_id, EBNFToken* production);
+        // Index of the root node of the production, or -1 if the nonterminal has no production
+        int get_production(int nonterminal_id) const;
+        // The nodes of a production are the range [get_production(), get_production_end())
+        int get_production_end(int nonterminal_id) const;
+        int get_production_count() const;
+
+        // Replace the whole IR, including its First sets, e.g. with one loaded from a grammar cache
+        void assign(std::vector<Node> new_nodes, std::vector<SymbolSet> new_first_sets, std::vector<int> new_production_roots, std::vector<int> new_production_ends);
+
+        const Node& get_node(int index) const;
+        int get_node_count() const;
+
+        // First sets of every node, filled in by Grammar::finalize_grammar()
+        SymbolSet& get_first_set(int index);
+        bool is_nullable(int index) const;
+        void reset_first_sets(int width);
+
+        // Same format as EBNFToken::to_string()
+        std::string to_string(int index, const SymbolTable& symbol_table) const;
+
+    private:
+        std::vector<Node> nodes;
+        std::vector<SymbolSet> first_sets;
+        std::vector<int> production_roots;
+        std::vector<int> production_ends;
+
+        void add_children(int index, EBNFToken* ebnf_token);
+    };
+
+} // namespace ParserGenerator
+
+#endif
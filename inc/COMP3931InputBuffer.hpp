@@ -0,0 +1,55 @@
+#ifndef __COMP3931_INPUTBUFFER_HEADER__
+#define __COMP3931_INPUTBUFFER_HEADER__
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+
+namespace ParserGenerator {
+
+    // Read-only view of a whole input file with a cursor. The file is memory mapped where the platform allows it,
+    // otherwise it is read in one go. Positions are byte offsets; lines and columns are only worked out for messages
+    class InputBuffer {
+    public:
+        InputBuffer();
+        ~InputBuffer();
+
+        InputBuffer(const InputBuffer&) = delete;
+        InputBuffer& operator=(const InputBuffer&) = delete;
+
+        bool open_file(const std::string& file_path);
+        // The contents are not copied so must outlive the InputBuffer
+        void open_string(std::string_view contents);
+        void close();
+
+        // Returns EOF at the end of the input
+        int peek() const;
+        bool get(char& c);
+
+        size_t get_position() const;
+        size_t get_size() const;
+        std::string_view get_contents() const;
+        std::string_view slice(size_t begin, size_t end) const;
+
+        // Store a string built while parsing (e.g. with escape sequences removed) for the lifetime of the buffer
+        std::string_view keep(std::string value);
+
+        // `line L, column C` for a byte offset (1 based)
+        std::string describe_position(size_t offset) const;
+        std::string describe_position() const;
+
+    private:
+        const char* data;
+        size_t size;
+        size_t position;
+
+        void* mapped_data;
+        size_t mapped_size;
+        std::string read_data;
+        std::deque<std::string> kept_strings;
+    };
+
+} // namespace ParserGenerator
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef __COMP3931_INTERPRETER_HEADER__
+#define __COMP3931_INTERPRETER_HEADER__
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "COMP3931Grammar.hpp"
+#include "COMP3931LexerDFA.hpp"
+#include "COMP3931ParserGenerator.hpp"
+
+namespace ParserGenerator {
+
+    // A token read by the Interpreter. kind is a terminal ID, or the terminal count for text which starts no terminal
+    struct InterpreterToken {
+        int kind;
+        std::string_view lexeme;
+        int line_number;
+        int char_position;
+    };
+
+    // Where the Interpreter reads tokens from, with the same functions as the VirtualLexer of a generated parser. Once
+    // the end of the input is reached it keeps returning the EOF token
+    class TokenSource {
+    public:
+        virtual ~TokenSource();
+
+        virtual const InterpreterToken& get_next_token() = 0;
+        virtual const InterpreterToken& peak_next_token() = 0;
+    };
+
+    // Token source over tokens which were all lexed beforehand, such as by Interpreter::lex(). They must end with EOF
+    class TokenVector final : public TokenSource {
+    public:
+        TokenVector(const std::vector<InterpreterToken>& tokens);
+
+        const InterpreterToken& get_next_token() {
+            // Keep returning the EOF token once the end is reached
+            if (next_token < tokens.size() - 1) {
+                return tokens[next_token++];
+            }
+            return tokens.back();
+        }
+
+        const InterpreterToken& peak_next_token() {
+            return tokens[next_token];
+        }
+
+        // Go back to the first token, so the same tokens can be parsed again
+        void rewind();
+
+    private:
+        const std::vector<InterpreterToken>& tokens;
+        size_t next_token;
+    };
+
+    // Called as the Interpreter parses, like the ParseEventHandler of a generated parser but with the IDs of the
+    // grammar's SymbolTable. Empty alternatives are not reported
+    class InterpreterEventHandler {
+    public:
+        virtual ~InterpreterEventHandler();
+
+        virtual void enter(int nonterminal_id) = 0;
+        virtual void token(int terminal_id, std::string_view lexeme) = 0;
+        virtual void exit(int nonterminal_id) = 0;
+    };
+
+    // Parse tree with the same shape and labels as the ParseTreeNode tree of a generated parser. Nodes are indices into
+    // one vector, with 0 the unlabelled root. Labels are views of the Interpreter and lexemes views of the parsed text
+    class InterpretedTree {
+    public:
+        struct Node {
+            std::string_view token;
+            // Children are a list through next_sibling, -1 ending it
+            int first_child;
+            int last_child;
+            int next_sibling;
+        };
+
+        InterpretedTree();
+
+        // Remove every node but the root
+        void clear();
+        int add_child(int parent, std::string_view token);
+
+        const Node& get_node(int index) const;
+        int get_root() const;
+        int size() const;
+
+        // The same format as parse_tree_gnu_plot() of a generated parser, so the two can be compared
+        bool write_gnu_plot(const std::string& file_name) const;
+
+    private:
+        std::vector<Node> nodes;
+    };
+
+    // Parses input with a finalized grammar directly, without generating and compiling a parser. It walks the grammar's
+    // IR with an explicit stack and the LL(1) predictions of the table driven parser, so the tree and events are those
+    // a generated parser would give. The grammar must pass Generator::validate() and outlive the Interpreter
+    class Interpreter {
+    public:
+        // The comment options are used by lex(), which fails if they do
+        Interpreter(Grammar& grammar, const GeneratorOptions& options = GeneratorOptions());
+        ~Interpreter();
+
+        // Lex text with the automaton DFALexer would be generated with, appending its tokens and EOF to tokens. The
+        // tokens are views of text
+        bool lex(std::string_view text, std::vector<InterpreterToken>& tokens);
+
+        // Parse tokens into the tree, or calling handler. Both stop at the first syntax error, returning false
+        bool parse(TokenSource& lexer, InterpretedTree& tree);
+        bool parse(TokenSource& lexer, InterpreterEventHandler& handler);
+
+        // Message for the last syntax error, in the same words as the InvalidTokenException of a generated parser
+        const std::string& get_error() const;
+
+    private:
+        // A node of the grammar being parsed, like ParseFrame in the table driven parser
+        struct Frame {
+            int node;
+            int next_child;
+            // Set for the frame which finishes a nonterminal, otherwise -1
+            int nonterminal;
+            int tree_node;
+        };
+
+        Grammar& grammar;
+        LexerDFA dfa;
+        bool has_lexer;
+        std::string block_comment_end;
+
+        int terminal_count;
+        int start_production;
+        int start_nonterminal;
+        // Prediction row of each decision node, and the rows one after another with terminal_count + 1 entries each
+        std::vector<int> decisions;
+        std::vector<int> predictions;
+        // Expected value reported when a terminal or OR node does not match
+        std::vector<std::string> expected_values;
+        // Tree labels of the terminals, then of the nonterminals
+        std::vector<std::string> labels;
+        // Terminals whose lexeme is a child of their node in the tree
+        std::vector<bool> has_lexeme;
+
+        std::vector<Frame> parse_stack;
+        std::string error;
+
+        // Run the parse, with Output adding to a tree or calling an event handler
+        template <typename Output>
+        bool run(TokenSource& lexer, Output& output);
+        void parsing_error(const InterpreterToken& found_token, int node_index);
+    };
+
+} // namespace ParserGenerator
+
+#endif
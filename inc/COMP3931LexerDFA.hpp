@@ -0,0 +1,76 @@
+#ifndef __COMP3931_LEXERDFA_HEADER__
+#define __COMP3931_LEXERDFA_HEADER__
+
+#include <bitset>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ParserGenerator {
+
+    // Deterministic automaton recognising a set of token patterns, built from them with the subset construction
+    // When the same text matches more than one pattern the one added first wins, so keywords go before identifiers
+    class LexerDFA {
+    public:
+        // Every transition out of the dead state goes back to it. Scanning starts in the start state
+        static const int DEAD_STATE = 0;
+        static const int START_STATE = 1;
+        // Accept value of a state which does not end a token
+        static const int NO_ACCEPT = -1;
+
+        LexerDFA();
+
+        // Remove every pattern and the automaton
+        void clear();
+
+        // Each pattern makes the states which end it accept the given value, which must not be NO_ACCEPT
+        void add_literal(const std::string& text, int accept);
+        // [A-Za-z_][A-Za-z0-9_]*
+        void add_identifier(int accept);
+        // [0-9]+
+        void add_number(int accept);
+        // Double quoted, without escapes, and may span lines
+        void add_string(int accept);
+        // Any run of spaces, tabs and line breaks
+        void add_whitespace(int accept);
+
+        // Build the automaton from the patterns added so far, then group the bytes which it never tells apart
+        void build();
+
+        int get_state_count() const;
+        int get_class_count() const;
+        int get_char_class(unsigned char c) const;
+        int get_transition(int state, int char_class) const;
+        int get_accept(int state) const;
+
+    private:
+        typedef std::bitset<256> CharSet;
+
+        // NFA used to build the automaton. A pattern has one start state and no epsilon moves
+        struct NFAState {
+            std::vector<std::pair<CharSet, int>> edges;
+            // Index of the pattern ended by this state, or -1
+            int pattern;
+        };
+
+        std::vector<NFAState> nfa_states;
+        std::vector<int> pattern_starts;
+        std::vector<int> pattern_accepts;
+
+        // Class of each byte, and the transitions of each state by class
+        std::vector<int> char_classes;
+        int class_count;
+        std::vector<int> transitions;
+        std::vector<int> accepts;
+
+        int add_nfa_state();
+        // Start a new pattern, returning its start state
+        int add_pattern(int accept);
+        void add_edge(int from, const CharSet& chars, int to);
+        void set_accepting(int state);
+        CharSet char_range(char first, char last);
+    };
+
+} // namespace ParserGenerator
+
+#endif
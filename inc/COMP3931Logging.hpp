@@ -0,0 +1,32 @@
+#ifndef __COMP3931_LOGGING_HEADER__
+#define __COMP3931_LOGGING_HEADER__
+
+#include "spdlog/spdlog.h"
+
+// Compile time minimum log level, using the spdlog level numbers (SPDLOG_LEVEL_TRACE = 0 ... SPDLOG_LEVEL_OFF = 6)
+// Trace and debug statements below this level are removed by the preprocessor, arguments and all
+#ifndef COMP3931_LOG_ACTIVE_LEVEL
+#define COMP3931_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+// The arguments are only evaluated when the level is enabled at runtime, so calls like to_string() cost nothing when filtered
+#define COMP3931_LOG(level, ...) \
+    do { \
+        if (spdlog::should_log(level)) { \
+            spdlog::log(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if COMP3931_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define COMP3931_TRACE(...) COMP3931_LOG(spdlog::level::trace, __VA_ARGS__)
+#else
+#define COMP3931_TRACE(...) (void)0
+#endif
+
+#if COMP3931_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define COMP3931_DEBUG(...) COMP3931_LOG(spdlog::level::debug, __VA_ARGS__)
+#else
+#define COMP3931_DEBUG(...) (void)0
+#endif
+
+#endif
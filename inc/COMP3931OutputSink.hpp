@@ -0,0 +1,64 @@
+#ifndef __COMP3931_OUTPUTSINK_HEADER__
+#define __COMP3931_OUTPUTSINK_HEADER__
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "spdlog/common.h"
+
+namespace ParserGenerator {
+
+    // Write contents with one write to file_name + ".tmp", then rename it over file_name so the file is never seen half
+    // written. Failures are logged at level, and leave no temporary file behind
+    bool replace_file(const std::string& file_name, std::string_view contents, spdlog::level::level_enum level = spdlog::level::err);
+
+    // Where the Generator puts each generated file once its whole contents are built in memory
+    class OutputSink {
+    public:
+        virtual ~OutputSink();
+
+        virtual bool write(const std::string& file_name, const std::string& contents) = 0;
+        // Forget a file, called for every file when generation fails so no output is left from an earlier run
+        virtual void discard(const std::string& file_name) = 0;
+    };
+
+    // Keeps the files in memory, for callers which use the generated code without it touching the disk
+    class StringSink : public OutputSink {
+    public:
+        bool write(const std::string& file_name, const std::string& contents);
+        void discard(const std::string& file_name);
+
+        // Empty if the file was not generated
+        const std::string& get_contents(const std::string& file_name) const;
+        const std::map<std::string, std::string>& get_files() const;
+
+    private:
+        std::map<std::string, std::string> files;
+    };
+
+    // Writes each file with replace_file(). A file which already has the same contents is left alone, so nothing built
+    // from it is rebuilt
+    class FileSink : public OutputSink {
+    public:
+        bool write(const std::string& file_name, const std::string& contents);
+        void discard(const std::string& file_name);
+    };
+
+    // Writes every file to a stream, by default stdout, each after a comment line naming it
+    class StreamSink : public OutputSink {
+    public:
+        StreamSink();
+        StreamSink(std::ostream& stream);
+
+        bool write(const std::string& file_name, const std::string& contents);
+        void discard(const std::string& file_name);
+
+    private:
+        std::ostream& stream;
+    };
+
+} // namespace ParserGenerator
+
+#endif
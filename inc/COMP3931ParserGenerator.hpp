@@ -1,9 +1,15 @@
 #ifndef __COMP3931_PARSER_GENERATOR_HEADER__
 #define __COMP3931_PARSER_GENERATOR_HEADER__
 
+#include <cstdint>
+#include <ostream>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "COMP3931Grammar.hpp"
+#include "COMP3931LexerDFA.hpp"
+#include "COMP3931OutputSink.hpp"
 
 namespace ParserGenerator {
 
@@ -11,42 +17,69 @@ namespace ParserGenerator {
     // The R prefix shows the strings are raw strings
     // The V0G0N delimiter is an escape sequence that allows the use of ) in the raw sequence
     const std::string header_lexer_token_class =
-R"V0G0N(class LexerToken {
+R"V0G0N(// The strings of a token are views, so the lexer must keep the text they refer to for as long as the tokens are used
+class LexerToken {
     public:
-        LexerToken(std::string lexeme, std::string token_type, int line_number, int char_position, std::string file_name);
+        // The kind is worked out from the lexeme and token type with classify_token()
+        LexerToken(std::string_view lexeme, std::string_view token_type, int line_number, int char_position, std::string_view file_name);
+        LexerToken(TokenKind kind, std::string_view lexeme, std::string_view token_type, int line_number, int char_position, std::string_view file_name);
         ~LexerToken();
 
-        std::string get_lexeme();
-        std::string get_token_type();
-        int get_line_number();
-        int get_char_position();
-        std::string get_file_name();
+        std::string_view get_lexeme() const;
+        std::string_view get_token_type() const;
+        TokenKind get_kind() const;
+        int get_line_number() const;
+        int get_char_position() const;
+        std::string_view get_file_name() const;
 
     protected:
-        std::string lexeme;
-        std::string token_type;
+        std::string_view lexeme;
+        std::string_view token_type;
         int line_number;
         int char_position;
-        std::string file_name;
+        std::string_view file_name;
+        TokenKind kind;
 };)V0G0N";
 
     const std::string source_lexer_token_class =
-R"V0G0N(LexerToken::LexerToken(std::string lexeme, std::string token_type, int line_number, int char_position, std::string file_name) : lexeme(lexeme), token_type(token_type), line_number(line_number), char_position(char_position), file_name(file_name) {}
+R"V0G0N(LexerToken::LexerToken(std::string_view lexeme, std::string_view token_type, int line_number, int char_position, std::string_view file_name) : lexeme(lexeme), token_type(token_type), line_number(line_number), char_position(char_position), file_name(file_name), kind(classify_token(lexeme, token_type)) {}
+LexerToken::LexerToken(TokenKind kind, std::string_view lexeme, std::string_view token_type, int line_number, int char_position, std::string_view file_name) : lexeme(lexeme), token_type(token_type), line_number(line_number), char_position(char_position), file_name(file_name), kind(kind) {}
 LexerToken::~LexerToken() {}
 
-std::string LexerToken::get_lexeme() { return lexeme; }
+std::string_view LexerToken::get_lexeme() const { return lexeme; }
+
+std::string_view LexerToken::get_token_type() const { return token_type; }
+
+TokenKind LexerToken::get_kind() const { return kind; }
 
-std::string LexerToken::get_token_type() { return token_type; }
+int LexerToken::get_line_number() const { return line_number; }
 
-int LexerToken::get_line_number() { return line_number; }
+int LexerToken::get_char_position() const { return char_position; }
 
-int LexerToken::get_char_position() { return char_position; })V0G0N";
+std::string_view LexerToken::get_file_name() const { return file_name; })V0G0N";
 
     const std::string header_virtual_lexer_class =
-R"V0G0N(class VirtualLexer {
+R"V0G0N(// The parser only looks at the TokenKind of the tokens returned, plus the lexeme of identifiers and constants
+// A returned token only has to stay valid until the next call, so a lexer can reuse a small buffer of tokens, but the
+// text its strings are views of must stay valid until parsing has finished
+class VirtualLexer {
     public:
-        virtual LexerToken& get_next_token() = 0;
-        virtual LexerToken& peak_next_token() = 0;
+        virtual const LexerToken& get_next_token() = 0;
+        virtual const LexerToken& peak_next_token() = 0;
+#ifdef GENERATED_PARSER_INCREMENTAL
+        // Index of the token get_next_token() returns next, and moving to another token, used by reparse()
+        virtual size_t get_token_index() const = 0;
+        virtual void seek_token(size_t token_index) = 0;
+#endif
+};)V0G0N";
+
+    const std::string header_token_edit_struct =
+R"V0G0N(// Tokens replaced by an edit of the text. The old tokens [first_token, first_token + removed_tokens) became the new tokens
+// [first_token, first_token + added_tokens), and the tokens after them only moved
+struct TokenEdit {
+    size_t first_token;
+    size_t removed_tokens;
+    size_t added_tokens;
 };)V0G0N";
 
     const std::string header_invalid_token_exception_class =
@@ -80,63 +113,1041 @@ InternalErrorException::InternalErrorException(std::string message) : runtime_er
 InternalErrorException::~InternalErrorException() {})V0G0N";
 
     const std::string header_parse_tree_node_class =
-R"V0G0N(class ParseTreeNode {
+R"V0G0N(class ParseTreeArena;
+
+// Nodes are created by a ParseTreeArena and are freed with it, never on their own
+// The label is not copied, so it must be a string literal or a lexeme from the lexer, or copied into the arena
+class ParseTreeNode {
+    public:
+        // Range of the children of a node, for use with range-based for
+        class ChildRange {
+            public:
+                ChildRange(ParseTreeNode* const* first, ParseTreeNode* const* last);
+
+                ParseTreeNode* const* begin() const;
+                ParseTreeNode* const* end() const;
+                size_t size() const;
+
+            private:
+                ParseTreeNode* const* first;
+                ParseTreeNode* const* last;
+        };
+
+        ParseTreeNode(std::string_view token);
+
+        // The children start in an array inside the node, so a node cannot be copied
+        ParseTreeNode(const ParseTreeNode&) = delete;
+        ParseTreeNode& operator=(const ParseTreeNode&) = delete;
+
+        std::string_view get_token() const;
+        // Children past the inline array are stored in memory taken from the arena
+        void add_child(ParseTreeNode* new_child, ParseTreeArena& arena);
+        ChildRange get_children() const;
+#ifdef GENERATED_PARSER_INCREMENTAL
+        // NonterminalKind of a nonterminal's node, otherwise TK_UNKNOWN
+        int get_kind() const;
+        // Tokens the node covers, 1 unless set. Nodes hold no token indices, so reused subtrees stay valid when
+        // tokens before them are added or removed
+        size_t get_token_count() const;
+        void set_span(int kind, size_t token_count);
+        void replace_child(int index, ParseTreeNode* new_child);
+#endif
+
+    private:
+        static const int INLINE_CHILDREN = 4;
+
+        std::string_view token;
+        ParseTreeNode** children;
+        int child_count;
+        int child_capacity;
+#ifdef GENERATED_PARSER_INCREMENTAL
+        int kind;
+        size_t token_count;
+#endif
+        ParseTreeNode* inline_children[INLINE_CHILDREN];
+};
+
+// Allocates parse tree nodes from blocks which double in size, so a whole tree is freed by releasing the blocks
+class ParseTreeArena {
     public:
-        ParseTreeNode(std::string token);
-        ~ParseTreeNode();
+        ParseTreeArena();
+        ~ParseTreeArena();
+
+        ParseTreeArena(const ParseTreeArena&) = delete;
+        ParseTreeArena& operator=(const ParseTreeArena&) = delete;
+
+        ParseTreeNode* create_node(std::string_view token);
+        void* allocate(size_t size);
+#ifdef GENERATED_PARSER_INCREMENTAL
+        // Copy a lexeme into the arena, as the lexer's text changes with each edit
+        std::string_view copy_string(std::string_view text);
+#endif
+        // Free every node. The first block is kept for the next tree
+        void reset();
 
-        std::string get_token();
-        void add_child(ParseTreeNode* new_child);
-        std::vector<ParseTreeNode*>& get_children();
+        size_t get_node_count() const;
+        size_t get_block_count() const;
+        size_t get_bytes_used() const;
+        size_t get_bytes_reserved() const;
+        size_t get_peak_bytes_reserved() const;
 
     private:
-        std::string token;
-        std::vector<ParseTreeNode*> children;
+        static const size_t MIN_BLOCK_SIZE = 4 * 1024;
+        static const size_t MAX_BLOCK_SIZE = 256 * 1024;
+
+        std::vector<char*> blocks;
+        size_t first_block_size;
+        size_t next_block_size;
+        char* current;
+        size_t remaining;
+        size_t node_count;
+        size_t bytes_used;
+        size_t bytes_reserved;
+        size_t peak_bytes_reserved;
 };)V0G0N";
 
     const std::string source_parse_tree_node_class =
-R"V0G0N(ParseTreeNode::ParseTreeNode(std::string token) : token(token) {}
+R"V0G0N(ParseTreeNode::ChildRange::ChildRange(ParseTreeNode* const* first, ParseTreeNode* const* last) : first(first), last(last) {}
 
-ParseTreeNode::~ParseTreeNode() {
-    for (const ParseTreeNode* child : children) {
-        delete child;
-    }
-}
+ParseTreeNode* const* ParseTreeNode::ChildRange::begin() const { return first; }
+
+ParseTreeNode* const* ParseTreeNode::ChildRange::end() const { return last; }
 
-std::string ParseTreeNode::get_token() { return token; }
+size_t ParseTreeNode::ChildRange::size() const { return last - first; }
 
-void ParseTreeNode::add_child(ParseTreeNode* new_child) {
+#ifdef GENERATED_PARSER_INCREMENTAL
+ParseTreeNode::ParseTreeNode(std::string_view token) : token(token), children(inline_children), child_count(0), child_capacity(INLINE_CHILDREN), kind(TK_UNKNOWN), token_count(1) {}
+#else
+ParseTreeNode::ParseTreeNode(std::string_view token) : token(token), children(inline_children), child_count(0), child_capacity(INLINE_CHILDREN) {}
+#endif
+
+std::string_view ParseTreeNode::get_token() const { return token; }
+
+void ParseTreeNode::add_child(ParseTreeNode* new_child, ParseTreeArena& arena) {
     if (new_child == nullptr || new_child == NULL) {
         return;
     }
 
-    children.push_back(new_child);
+    if (child_count == child_capacity) {
+        // The old array is left in the arena and freed with the rest of the tree
+        ParseTreeNode** new_children = static_cast<ParseTreeNode**>(arena.allocate(2 * child_capacity * sizeof(ParseTreeNode*)));
+        std::copy(children, children + child_count, new_children);
+        children = new_children;
+        child_capacity *= 2;
+    }
+
+    children[child_count++] = new_child;
+}
+
+ParseTreeNode::ChildRange ParseTreeNode::get_children() const { return ChildRange(children, children + child_count); }
+
+#ifdef GENERATED_PARSER_INCREMENTAL
+int ParseTreeNode::get_kind() const { return kind; }
+
+size_t ParseTreeNode::get_token_count() const { return token_count; }
+
+void ParseTreeNode::set_span(int kind, size_t token_count) {
+    this->kind = kind;
+    this->token_count = token_count;
+}
+
+void ParseTreeNode::replace_child(int index, ParseTreeNode* new_child) { children[index] = new_child; }
+#endif
+
+ParseTreeArena::ParseTreeArena() : first_block_size(0), next_block_size(MIN_BLOCK_SIZE), current(nullptr), remaining(0), node_count(0), bytes_used(0), bytes_reserved(0), peak_bytes_reserved(0) {}
+
+ParseTreeArena::~ParseTreeArena() {
+    for (char* block : blocks) {
+        delete[] block;
+    }
+}
+
+ParseTreeNode* ParseTreeArena::create_node(std::string_view token) {
+    node_count++;
+    return new (allocate(sizeof(ParseTreeNode))) ParseTreeNode(token);
+}
+
+void* ParseTreeArena::allocate(size_t size) {
+    // Keep every allocation aligned for the nodes and child pointers stored in them
+    size = (size + alignof(ParseTreeNode) - 1) & ~(alignof(ParseTreeNode) - 1);
+
+    if (size > remaining) {
+        size_t block_size = size > next_block_size ? size : next_block_size;
+        next_block_size = next_block_size * 2 > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : next_block_size * 2;
+        blocks.push_back(new char[block_size]);
+
+        if (blocks.size() == 1) {
+            first_block_size = block_size;
+        }
+
+        current = blocks.back();
+        remaining = block_size;
+        bytes_reserved += block_size;
+
+        if (bytes_reserved > peak_bytes_reserved) {
+            peak_bytes_reserved = bytes_reserved;
+        }
+    }
+
+    void* memory = current;
+    current += size;
+    remaining -= size;
+    bytes_used += size;
+
+    return memory;
+}
+
+#ifdef GENERATED_PARSER_INCREMENTAL
+std::string_view ParseTreeArena::copy_string(std::string_view text) {
+    char* copy = static_cast<char*>(allocate(text.size()));
+    std::copy(text.begin(), text.end(), copy);
+    return std::string_view(copy, text.size());
+}
+#endif
+
+void ParseTreeArena::reset() {
+    // Nodes have nothing to destroy, so only the blocks need freeing
+    for (size_t i = 1; i < blocks.size(); i++) {
+        delete[] blocks[i];
+    }
+
+    if (blocks.empty()) {
+        current = nullptr;
+        remaining = 0;
+        bytes_reserved = 0;
+        next_block_size = MIN_BLOCK_SIZE;
+    } else {
+        blocks.resize(1);
+        current = blocks[0];
+        remaining = first_block_size;
+        bytes_reserved = first_block_size;
+        next_block_size = first_block_size * 2 > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : first_block_size * 2;
+    }
+
+    node_count = 0;
+    bytes_used = 0;
+}
+
+size_t ParseTreeArena::get_node_count() const { return node_count; }
+
+size_t ParseTreeArena::get_block_count() const { return blocks.size(); }
+
+size_t ParseTreeArena::get_bytes_used() const { return bytes_used; }
+
+size_t ParseTreeArena::get_bytes_reserved() const { return bytes_reserved; }
+
+size_t ParseTreeArena::get_peak_bytes_reserved() const { return peak_bytes_reserved; })V0G0N";
+
+    const std::string header_flat_parse_tree_class =
+R"V0G0N(// Parse tree stored as parallel arrays in preorder, so a node is an index and the nodes of a subtree are
+// the range [node, get_subtree_end(node))
+class FlatParseTree {
+    public:
+        // Steps over the children of a node by jumping to the end of each child's subtree, or over every
+        // node of a subtree one by one
+        class NodeIterator {
+            public:
+                NodeIterator(const FlatParseTree* tree, int node, bool skip_subtrees);
+
+                int operator*() const;
+                NodeIterator& operator++();
+                bool operator!=(const NodeIterator& other) const;
+                bool operator==(const NodeIterator& other) const;
+
+            private:
+                const FlatParseTree* tree;
+                int node;
+                bool skip_subtrees;
+        };
+
+        // Range of nodes, for use with range-based for
+        class NodeRange {
+            public:
+                NodeRange(NodeIterator first, NodeIterator last);
+
+                NodeIterator begin() const;
+                NodeIterator end() const;
+
+            private:
+                NodeIterator first;
+                NodeIterator last;
+        };
+
+        // Nodes must be added in preorder. A new node is a leaf until close_node() is called after its children are added
+        int add_node(int kind, int parent, int token_index);
+        void close_node(int node);
+        // The token is copied, but its strings are still views of the lexer's text
+        int add_token(const LexerToken& token);
+        void clear();
+
+        int size() const;
+        int get_kind(int node) const;
+        // -1 for the root
+        int get_parent(int node) const;
+        // One past the last node of the subtree
+        int get_subtree_end(int node) const;
+        // -1 if the node has no token
+        int get_token_index(int node) const;
+        const LexerToken& get_token(int token_index) const;
+        std::string_view get_label(int node) const;
+
+        NodeRange get_children(int node) const;
+        // The node followed by all of its descendants
+        NodeRange get_subtree(int node) const;
+
+    private:
+        std::vector<int> kinds;
+        std::vector<int> parents;
+        std::vector<int> subtree_ends;
+        std::vector<int> token_indices;
+        std::vector<LexerToken> tokens;
+};)V0G0N";
+
+    const std::string source_flat_parse_tree_class =
+R"V0G0N(FlatParseTree::NodeIterator::NodeIterator(const FlatParseTree* tree, int node, bool skip_subtrees) : tree(tree), node(node), skip_subtrees(skip_subtrees) {}
+
+int FlatParseTree::NodeIterator::operator*() const { return node; }
+
+FlatParseTree::NodeIterator& FlatParseTree::NodeIterator::operator++() {
+    node = skip_subtrees ? tree->subtree_ends[node] : node + 1;
+    return *this;
+}
+
+bool FlatParseTree::NodeIterator::operator!=(const NodeIterator& other) const { return node != other.node; }
+
+bool FlatParseTree::NodeIterator::operator==(const NodeIterator& other) const { return node == other.node; }
+
+FlatParseTree::NodeRange::NodeRange(NodeIterator first, NodeIterator last) : first(first), last(last) {}
+
+FlatParseTree::NodeIterator FlatParseTree::NodeRange::begin() const { return first; }
+
+FlatParseTree::NodeIterator FlatParseTree::NodeRange::end() const { return last; }
+
+int FlatParseTree::add_node(int kind, int parent, int token_index) {
+    int node = kinds.size();
+
+    kinds.push_back(kind);
+    parents.push_back(parent);
+    subtree_ends.push_back(node + 1);
+    token_indices.push_back(token_index);
+
+    return node;
+}
+
+void FlatParseTree::close_node(int node) { subtree_ends[node] = kinds.size(); }
+
+int FlatParseTree::add_token(const LexerToken& token) {
+    tokens.push_back(token);
+    return tokens.size() - 1;
+}
+
+void FlatParseTree::clear() {
+    kinds.clear();
+    parents.clear();
+    subtree_ends.clear();
+    token_indices.clear();
+    tokens.clear();
+}
+
+int FlatParseTree::size() const { return kinds.size(); }
+
+int FlatParseTree::get_kind(int node) const { return kinds[node]; }
+
+int FlatParseTree::get_parent(int node) const { return parents[node]; }
+
+int FlatParseTree::get_subtree_end(int node) const { return subtree_ends[node]; }
+
+int FlatParseTree::get_token_index(int node) const { return token_indices[node]; }
+
+const LexerToken& FlatParseTree::get_token(int token_index) const { return tokens[token_index]; }
+
+std::string_view FlatParseTree::get_label(int node) const { return node_kind_label(kinds[node]); }
+
+FlatParseTree::NodeRange FlatParseTree::get_children(int node) const {
+    return NodeRange(NodeIterator(this, node + 1, true), NodeIterator(this, subtree_ends[node], true));
+}
+
+FlatParseTree::NodeRange FlatParseTree::get_subtree(int node) const {
+    return NodeRange(NodeIterator(this, node, false), NodeIterator(this, subtree_ends[node], false));
+})V0G0N";
+
+    const std::string header_parse_event_handler_class =
+R"V0G0N(// Receives the structure of the input from the parser instead of a parse tree. Each nonterminal is reported by
+// enter() before its contents and exit() after them, and each matched token by token(). Epsilon is not reported.
+// A handler which builds its own tree can keep or throw away each subtree at exit(), so memory use can stay constant
+class ParseEventHandler {
+    public:
+        virtual ~ParseEventHandler();
+
+        virtual void enter(NonterminalKind nonterminal);
+        // The lexeme is a view of the lexer's text and is only valid while the lexer keeps it
+        virtual void token(TokenKind kind, std::string_view lexeme);
+        virtual void exit(NonterminalKind nonterminal);
+};)V0G0N";
+
+    const std::string source_parse_event_handler_class =
+R"V0G0N(ParseEventHandler::~ParseEventHandler() {}
+
+void ParseEventHandler::enter(NonterminalKind) {}
+
+void ParseEventHandler::token(TokenKind, std::string_view) {}
+
+void ParseEventHandler::exit(NonterminalKind) {})V0G0N";
+
+    // FNV-1a from a seed, with the high bits folded down as only the low bits pick the slot
+    const std::string source_terminal_hash_function =
+R"V0G0N(static inline uint32_t terminal_hash(std::string_view lexeme) {
+    uint32_t hash = TERMINAL_HASH_SEED;
+
+    for (char c : lexeme) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+
+    return hash ^ (hash >> 16);
 }
 
-std::vector<ParseTreeNode*>& ParseTreeNode::get_children() { return children; })V0G0N";
+// Mix a hash with the displacement of its bucket, picking its slot
+static inline uint32_t terminal_displace(uint32_t hash, uint32_t displacement) {
+    uint32_t slot = hash + displacement;
+
+    slot = (slot ^ (slot >> 16)) * 0x7feb352du;
+    slot = (slot ^ (slot >> 15)) * 0x846ca68bu;
+
+    return slot ^ (slot >> 16);
+})V0G0N";
+
+    const std::string source_token_set_function =
+R"V0G0N(// Check if a kind is in a set of kinds stored as a bitmask
+static inline bool token_in_set(const uint64_t* token_set, TokenKind kind) {
+    return (token_set[kind / 64] >> (kind % 64)) & 1;
+})V0G0N";
+
+    const std::string source_reparse_function =
+R"V0G0N(reparse(const std::vector<TokenEdit>& edits) {
+    // Without a whole tree built from the lexer's tokens there is nothing to reuse
+    if (!reusable_tree) {
+        lexer.seek_token(0);
+        start_parsing();
+        return lexer.get_token_index();
+    }
+
+    if (edits.empty()) {
+        return 0;
+    }
+
+    reusable_tree = false;
+
+    // Merge the edits into one range of old tokens which became a range of new tokens. Each edit numbers the tokens as
+    // they were after the edits before it
+    size_t damage_start = edits[0].first_token;
+    size_t removed_tokens = edits[0].removed_tokens;
+    size_t added_tokens = edits[0].added_tokens;
+
+    for (size_t i = 1; i < edits.size(); i++) {
+        size_t start = std::min(damage_start, edits[i].first_token);
+        size_t end = std::max(damage_start + added_tokens, edits[i].first_token + edits[i].removed_tokens);
+
+        removed_tokens = end - added_tokens + removed_tokens - start;
+        added_tokens = end + edits[i].added_tokens - edits[i].removed_tokens - start;
+        damage_start = start;
+    }
+
+    size_t damage_end = damage_start + removed_tokens;
+    std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(added_tokens) - static_cast<std::ptrdiff_t>(removed_tokens);
+
+    // Nonterminals from the root down which start before the damage and end at or after it. A nonterminal is parsed the
+    // same way wherever it is called from, and its first token and so the call to it did not change
+    struct PathEntry {
+        ParseTreeNode* parent;
+        int child_index;
+        size_t first_token;
+    };
+
+    std::vector<PathEntry> path;
+    ParseTreeNode* node = parse_tree_root;
+    bool found = true;
+
+    while (found) {
+        found = false;
+        int child_index = 0;
+        size_t child_start = path.empty() ? 0 : path.back().first_token;
+
+        for (ParseTreeNode* child : node->get_children()) {
+            size_t child_end = child_start + child->get_token_count();
+
+            if (child->get_kind() != TK_UNKNOWN && child_start < damage_start && child_end >= damage_end) {
+                path.push_back({node, child_index, child_start});
+                node = child;
+                found = true;
+                break;
+            }
+
+            child_start = child_end;
+            child_index++;
+        }
+    }
+
+    // Try the deepest first. Its new subtree must end where the old one now ends, as the parse after it then carries on
+    // from the same token in the same way
+    for (size_t i = path.size(); i-- > 0;) {
+        ParseTreeNode* old_node = path[i].parent->get_children().begin()[path[i].child_index];
+        size_t old_end = path[i].first_token + old_node->get_token_count();
+
+        collect_reusable_nodes(old_node, path[i].first_token, damage_start, damage_end, delta);
+        next_reusable = 0;
+        reused_token_count = 0;
+
+        ParseTreeNode* holder = tree_arena.create_node("");
+        lexer.seek_token(path[i].first_token);
+        parse_nonterminal(old_node->get_kind(), holder);
+        reusable_nodes.clear();
+
+        if (lexer.get_token_index() == old_end + delta) {
+            path[i].parent->replace_child(path[i].child_index, holder->get_children().begin()[0]);
+
+            for (size_t j = 0; j <= i; j++) {
+                path[j].parent->set_span(path[j].parent->get_kind(), path[j].parent->get_token_count() + delta);
+            }
+
+            reusable_tree = true;
+            return lexer.get_token_index() - path[i].first_token - reused_token_count;
+        }
+    }
+
+    // The old nodes stay in the arena until the next full parse, which frees them
+    lexer.seek_token(0);
+    start_parsing();
+    return lexer.get_token_index();
+})V0G0N";
+
+    const std::string source_collect_reusable_nodes_function =
+R"V0G0N(collect_reusable_nodes(ParseTreeNode* node, size_t first_token, size_t damage_start, size_t damage_end, std::ptrdiff_t delta) {
+    size_t child_start = first_token;
+
+    for (ParseTreeNode* child : node->get_children()) {
+        size_t child_end = child_start + child->get_token_count();
+
+        if (child->get_kind() != TK_UNKNOWN) {
+            // A nonterminal parses the same while its tokens and the one after it, which ended it, are unchanged
+            if (child_end < damage_start || child_start >= damage_end) {
+                size_t new_start = child_start >= damage_end ? child_start + delta : child_start;
+                ParseTreeNode* chain = child;
+
+                // The nonterminals starting at the same token inside it can be reused on their own, if the new parse
+                // calls a different one there
+                while (true) {
+                    reusable_nodes.push_back({new_start, chain});
+                    ParseTreeNode::ChildRange children = chain->get_children();
+
+                    if (children.size() == 0 || children.begin()[0]->get_kind() == TK_UNKNOWN) {
+                        break;
+                    }
+                    chain = children.begin()[0];
+                }
+            } else {
+                collect_reusable_nodes(child, child_start, damage_start, damage_end, delta);
+            }
+        }
+
+        child_start = child_end;
+    }
+})V0G0N";
+
+    const std::string source_reuse_subtree_function =
+R"V0G0N(reuse_subtree(int kind, ParseTreeNode* parse_tree_parent) {
+    size_t token_index = lexer.get_token_index();
+
+    // The parse only moves forwards, so nodes starting before the next token can never be reused
+    while (next_reusable < reusable_nodes.size() && reusable_nodes[next_reusable].first_token < token_index) {
+        next_reusable++;
+    }
+
+    for (size_t i = next_reusable; i < reusable_nodes.size() && reusable_nodes[i].first_token == token_index; i++) {
+        ParseTreeNode* node = reusable_nodes[i].node;
+
+        if (node->get_kind() == kind) {
+            parse_tree_parent->add_child(node, tree_arena);
+            lexer.seek_token(token_index + node->get_token_count());
+            reused_token_count += node->get_token_count();
+            return true;
+        }
+    }
+
+    return false;
+})V0G0N";
+
+    const std::string header_parse_diagnostic_struct =
+R"V0G0N(// A syntax error found while parsing. The found lexeme is a view of the lexer's text, and expected points to a string
+// literal in the parser, so a diagnostic costs no allocations
+struct ParseDiagnostic {
+    int line_number;
+    int char_position;
+    std::string_view found;
+    const char* expected;
+
+    // The same message as InvalidTokenException
+    std::string get_message() const;
+};)V0G0N";
+
+    const std::string source_parse_diagnostic_struct =
+R"V0G0N(std::string ParseDiagnostic::get_message() const {
+    return "Line " + std::to_string(line_number) + ":" + std::to_string(char_position) + " Parsing error: expected `" + expected + "` but found `" + std::string(found) + "`";
+})V0G0N";
+
+    const std::string source_recovering_parser_error_function =
+R"V0G0N(parsing_error(const LexerToken& found_token, const char* expected_value) {
+    // A second error at the same token would loop forever, so skip the token instead of reporting it again
+    if (!diagnostics.empty() && diagnostics.back().line_number == found_token.get_line_number() && diagnostics.back().char_position == found_token.get_char_position()) {
+        skip_error_token = true;
+        return;
+    }
+
+    diagnostics.push_back({found_token.get_line_number(), found_token.get_char_position(), found_token.get_lexeme(), expected_value});
+})V0G0N";
+
+    const std::string source_synchronize_function =
+R"V0G0N(synchronize(const uint64_t* follow_set) {
+    if (skip_error_token && lexer.peak_next_token().get_kind() != TK_EOF) {
+        lexer.get_next_token();
+    }
+
+    skip_error_token = false;
+
+    while (lexer.peak_next_token().get_kind() != TK_EOF && !token_in_set(follow_set, lexer.peak_next_token().get_kind())) {
+        lexer.get_next_token();
+    }
+})V0G0N";
 
     const std::string source_parser_error_function =
-R"V0G0N(parsing_error(LexerToken& found_token, std::string expected_value) {
-    throw InvalidTokenException("Line " + std::to_string(found_token.get_line_number()) + ":" + std::to_string(found_token.get_char_position()) + " Parsing error: expected `" + expected_value + "` but found `" + found_token.get_lexeme() + "`");
+R"V0G0N(parsing_error(const LexerToken& found_token, std::string expected_value) {
+    throw InvalidTokenException("Line " + std::to_string(found_token.get_line_number()) + ":" + std::to_string(found_token.get_char_position()) + " Parsing error: expected `" + expected_value + "` but found `" + std::string(found_token.get_lexeme()) + "`");
 })V0G0N";
 
+    const std::string header_dfa_lexer_class =
+R"V0G0N(// Lexer generated from the terminals of the grammar. Every token is found by one table driven automaton which takes the
+// longest match, and keywords win over identifiers of the same length. Identifiers are [A-Za-z_][A-Za-z0-9_]*, numeric
+// constants [0-9]+, and string literals are double quoted with no escapes, their lexeme leaving out the quotes.
+// A character which starts no token becomes a TK_UNKNOWN token of its own, so the parser reports it
+class DFALexer final : public VirtualLexer {
+    public:
+        // Lex a whole file. If it cannot be read this throws std::runtime_error, or without exceptions only has EOF
+        DFALexer(const std::string& file_name);
+        // Lex text owned by the caller, which must outlive the lexer until the text is edited and the lexer copies it
+        DFALexer(std::string_view text, const std::string& file_name);
+        ~DFALexer();
+
+        // The tokens are views of the lexer's own text and file name
+        DFALexer(const DFALexer&) = delete;
+        DFALexer& operator=(const DFALexer&) = delete;
+
+        const LexerToken& get_next_token() {
+            // Keep returning the EOF token once the end is reached
+            if (next_token < tokens.size() - 1) {
+                return tokens[next_token++];
+            }
+            return tokens.back();
+        }
+
+        const LexerToken& peak_next_token() {
+            return tokens[next_token];
+        }
+
+        size_t get_token_index() const {
+            return next_token;
+        }
+
+        void seek_token(size_t token_index) {
+            next_token = std::min(token_index, tokens.size() - 1);
+        }
+
+        // Go back to the first token, so the same tokens can be parsed again
+        void rewind();
+        size_t get_token_count() const;
+        // False if the file could not be read
+        bool is_open() const;
+        std::string_view get_text() const;
+#ifdef GENERATED_PARSER_INCREMENTAL
+        // Replace removed_length characters at offset with inserted, and go back to the first token. Lexing starts
+        // again at the first token which looked at the changed text, and stops once a token starts where an old one
+        // after the change now starts. The tokens after that are moved rather than lexed again
+        TokenEdit edit_text(size_t offset, size_t removed_length, std::string_view inserted);
+#endif
+
+    private:
+        // Where lexing has got to. Lexing can start again from the start of any token
+        struct ScanPosition {
+            size_t offset;
+            int line_number;
+            size_t line_start;
+        };
+
+        std::string file_name;
+        std::string source;
+        // The text the tokens are views of, which is source unless the caller owns it
+        std::string_view text;
+        std::vector<LexerToken> tokens;
+#ifdef GENERATED_PARSER_INCREMENTAL
+        // Offset each token starts at, which is the quote of a string literal and the end of the text for EOF
+        std::vector<size_t> token_offsets;
+        // One past the furthest offset looked at to find each token, with the end of the text counted as a character
+        std::vector<size_t> token_read_ends;
+#endif
+        size_t next_token;
+        bool opened;
+
+        void scan();
+        // Lex the next token from position, skipping whitespace and comments, and move position past it. At the end of
+        // the text this gives EOF. start is set to the offset of the token, and read_end to how far the text was read
+        LexerToken scan_token(ScanPosition& position, size_t& start, size_t& read_end);
+};)V0G0N";
+
+    const std::string source_dfa_lexer_class =
+R"V0G0N(DFALexer::DFALexer(const std::string& file_name) : file_name(file_name), next_token(0), opened(false) {
+    std::ifstream file(file_name, std::ifstream::in | std::ifstream::binary);
+
+    if (file.is_open()) {
+        source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        opened = true;
+    } else {
+#ifdef __cpp_exceptions
+        throw std::runtime_error("Unable to open " + file_name);
+#endif
+    }
+
+    text = source;
+    scan();
+}
+
+DFALexer::DFALexer(std::string_view text, const std::string& file_name) : file_name(file_name), text(text), next_token(0), opened(true) {
+    scan();
+}
+
+DFALexer::~DFALexer() {}
+
+void DFALexer::rewind() { next_token = 0; }
+
+size_t DFALexer::get_token_count() const { return tokens.size(); }
+
+bool DFALexer::is_open() const { return opened; }
+
+std::string_view DFALexer::get_text() const { return text; }
+
+void DFALexer::scan() {
+    ScanPosition position = {0, 1, 0};
+    size_t start;
+    size_t read_end;
+
+    do {
+        tokens.push_back(scan_token(position, start, read_end));
+#ifdef GENERATED_PARSER_INCREMENTAL
+        token_offsets.push_back(start);
+        token_read_ends.push_back(read_end);
+#endif
+    } while (tokens.back().get_kind() != TK_EOF);
+}
+
+LexerToken DFALexer::scan_token(ScanPosition& position, size_t& start, size_t& read_end) {
+    read_end = 0;
+
+    while (position.offset < text.size()) {
+        // Run the automaton until it dies, remembering where it last accepted
+        start = position.offset;
+        size_t end = start + 1;
+        int accept = DFA_NO_ACCEPT;
+        DFAState state = DFA_START_STATE;
+        size_t i = start;
+
+        for (; i < text.size(); i++) {
+            state = dfa_transitions[state * DFA_CLASS_COUNT + dfa_char_classes[static_cast<unsigned char>(text[i])]];
+
+            if (state == DFA_DEAD_STATE) {
+                break;
+            }
+
+            if (dfa_accepts[state] != DFA_NO_ACCEPT) {
+                accept = dfa_accepts[state];
+                end = i + 1;
+            }
+        }
+
+        read_end = std::max(read_end, i + 1);
+        position.offset = end;
+
+        if (accept == DFA_LINE_COMMENT) {
+            size_t line_end = text.find('\n', position.offset);
+            position.offset = std::min(line_end, text.size());
+            read_end = std::max(read_end, std::min(line_end, text.size()) + 1);
+        } else if (accept == DFA_BLOCK_COMMENT) {
+            size_t comment_end = text.find(dfa_block_comment_end, position.offset);
+            position.offset = comment_end == std::string_view::npos ? text.size() : comment_end + dfa_block_comment_end.size();
+            read_end = std::max(read_end, comment_end == std::string_view::npos ? text.size() + 1 : position.offset);
+        }
+
+        // Comments, strings and whitespace can all span lines, and a token is on the line it starts on
+        int line_number = position.line_number;
+        size_t line_start = position.line_start;
+
+        for (size_t i = start; i < position.offset; i++) {
+            if (text[i] == '\n') {
+                position.line_number++;
+                position.line_start = i + 1;
+            }
+        }
+
+        if (accept != DFA_SKIP && accept != DFA_LINE_COMMENT && accept != DFA_BLOCK_COMMENT) {
+            TokenKind kind = accept == DFA_NO_ACCEPT ? TK_UNKNOWN : static_cast<TokenKind>(accept);
+            std::string_view lexeme = text.substr(start, position.offset - start);
+
+            if (kind == TK_STRING_LITERAL) {
+                lexeme = lexeme.substr(1, lexeme.size() - 2);
+            }
+
+            return LexerToken(kind, lexeme, dfa_token_type(kind), line_number, static_cast<int>(start - line_start) + 1, file_name);
+        }
+    }
+
+    // The end of the input is at the last character of the line, or 0 after a line break
+    start = position.offset;
+    read_end = text.size() + 1;
+    return LexerToken(TK_EOF, "", "EOF", position.line_number, static_cast<int>(position.offset - position.line_start), file_name);
+}
+
+#ifdef GENERATED_PARSER_INCREMENTAL
+TokenEdit DFALexer::edit_text(size_t offset, size_t removed_length, std::string_view inserted) {
+    offset = std::min(offset, text.size());
+    removed_length = std::min(removed_length, text.size() - offset);
+
+    // Start from the token before the first one whose lexing looked at the changed text, as lexing that one started
+    // at the end of the token before. EOF always looked at the end of the text
+    size_t first_token = 0;
+    while (token_read_ends[first_token] <= offset) {
+        first_token++;
+    }
+    first_token = first_token == 0 ? 0 : first_token - 1;
+
+    ScanPosition position = {0, 1, 0};
+    if (first_token > 0) {
+        position.offset = token_offsets[first_token];
+        position.line_number = tokens[first_token].get_line_number();
+        position.line_start = position.offset - (tokens[first_token].get_char_position() - 1);
+    }
+
+    // The text is copied the first time it is edited if the caller owns it
+    const char* old_data = text.data();
+    if (text.data() != source.data()) {
+        source.assign(text.data(), text.size());
+    }
+    source.replace(offset, removed_length, inserted.data(), inserted.size());
+    text = source;
+
+    // Old tokens starting after the removed text only move, by inserted.size() - removed_length
+    size_t old_token = std::lower_bound(token_offsets.begin(), token_offsets.end(), offset + removed_length) - token_offsets.begin();
+    auto moved_offset = [&](size_t index) { return token_offsets[index] + inserted.size() - removed_length; };
+
+    std::vector<LexerToken> new_tokens;
+    std::vector<size_t> new_offsets;
+    std::vector<size_t> new_read_ends;
+    int line_delta = 0;
+    int column_delta = 0;
+    int resync_line = 0;
+
+    while (true) {
+        size_t start;
+        size_t read_end;
+        LexerToken token = scan_token(position, start, read_end);
+
+        // Lexing from where an old token after the change starts sees the same text as before, so the rest is in step.
+        // EOF always is, so this ends at the latest at the end of the text
+        if (start >= offset + inserted.size()) {
+            while (old_token < tokens.size() && moved_offset(old_token) < start) {
+                old_token++;
+            }
+
+            if (old_token < tokens.size() && moved_offset(old_token) == start) {
+                resync_line = tokens[old_token].get_line_number();
+                line_delta = token.get_line_number() - resync_line;
+                column_delta = token.get_char_position() - tokens[old_token].get_char_position();
+                break;
+            }
+        }
+
+        new_tokens.push_back(token);
+        new_offsets.push_back(start);
+        new_read_ends.push_back(read_end);
+    }
+
+    // Every token is a view of the text, which may itself have moved
+    auto move_token = [&](size_t index, size_t new_offset, int line_delta, int column_delta) {
+        const LexerToken& token = tokens[index];
+        std::string_view lexeme = token.get_lexeme();
+
+        if (token.get_kind() != TK_EOF) {
+            lexeme = text.substr(new_offset + (token.get_kind() == TK_STRING_LITERAL ? 1 : 0), lexeme.size());
+        }
+
+        tokens[index] = LexerToken(token.get_kind(), lexeme, token.get_token_type(), token.get_line_number() + line_delta, token.get_char_position() + column_delta, file_name);
+    };
+
+    if (text.data() != old_data) {
+        for (size_t i = 0; i < first_token; i++) {
+            move_token(i, token_offsets[i], 0, 0);
+        }
+    }
+
+    for (size_t i = old_token; i < tokens.size(); i++) {
+        size_t new_offset = moved_offset(i);
+        move_token(i, new_offset, line_delta, tokens[i].get_line_number() == resync_line ? column_delta : 0);
+        token_read_ends[i] += inserted.size() - removed_length;
+        token_offsets[i] = new_offset;
+    }
+
+    TokenEdit edit = {first_token, old_token - first_token, new_tokens.size()};
+
+    tokens.erase(tokens.begin() + first_token, tokens.begin() + old_token);
+    tokens.insert(tokens.begin() + first_token, new_tokens.begin(), new_tokens.end());
+    token_offsets.erase(token_offsets.begin() + first_token, token_offsets.begin() + old_token);
+    token_offsets.insert(token_offsets.begin() + first_token, new_offsets.begin(), new_offsets.end());
+    token_read_ends.erase(token_read_ends.begin() + first_token, token_read_ends.begin() + old_token);
+    token_read_ends.insert(token_read_ends.begin() + first_token, new_read_ends.begin(), new_read_ends.end());
+    next_token = 0;
+
+    return edit;
+}
+#endif)V0G0N";
+
+    // Choices about the code produced by a Generator
+    struct GeneratorOptions {
+        enum TreeType {
+            // ParseTreeNode objects allocated from a ParseTreeArena
+            POINTER_TREE,
+            // FlatParseTree of parallel arrays in preorder
+            FLAT_TREE,
+            // No tree, the parser calls a ParseEventHandler instead
+            EVENTS
+        };
+
+        enum Backend {
+            // One parse function for each nonterminal
+            RECURSIVE_DESCENT,
+            // Tables of the grammar and LL(1) predictions, run by one function with an explicit stack
+            TABLE
+        };
+
+        TreeType tree_type = POINTER_TREE;
+        Backend backend = RECURSIVE_DESCENT;
+        // Record syntax errors and carry on parsing instead of throwing InvalidTokenException
+        bool error_recovery = false;
+        // Concrete lexers to compile the parser template for, besides VirtualLexer, and the headers declaring them
+        std::vector<std::string> lexer_classes;
+        std::vector<std::string> lexer_headers;
+        // Also generate DFALexer from the terminals, skipping comments which start with these. Empty means no comments
+        bool generate_lexer = false;
+        std::string line_comment;
+        std::string block_comment_start;
+        std::string block_comment_end;
+        // Let the parser parse again only the part of the tree an edit of the lexer's tokens touched
+        bool incremental = false;
+    };
+
     // Class to generate code files for a recursive descent parser from a grammar
     class Generator {
     public:
-        Generator(Grammar& grammar, std::string output_file_name);
+        // The files are given to sink, or written to output_file_name.hpp and .cpp by a FileSink if it is nullptr
+        Generator(Grammar& grammar, std::string output_file_name, GeneratorOptions options = GeneratorOptions(), OutputSink* sink = nullptr);
         ~Generator();
 
+        // Whether the grammar was valid and both files were generated and given to the sink
+        bool get_succeeded();
+
+        // Check a finalized grammar can be generated with the options, reporting every conflict rather than the first
+        static bool validate(Grammar& grammar, const GeneratorOptions& options);
+
+        // Accept values of the lexer automaton which are not a terminal ID
+        static const int DFA_SKIP = -2;
+        static const int DFA_LINE_COMMENT = -3;
+        static const int DFA_BLOCK_COMMENT = -4;
+
+        // Build the automaton DFALexer is generated with, from the terminals and comment options. Terminals are
+        // accepted as their IDs
+        static bool build_lexer_dfa(Grammar& grammar, const GeneratorOptions& options, LexerDFA& dfa);
+        // Give each OR, REPEAT and OPTIONAL in decisions the index of its row in rows, or -1 for other nodes. A row holds
+        // the child to parse for each terminal ID, with one more for unknown tokens, or -1 if none matches
+        static void build_predictions(Grammar& grammar, std::vector<int>& decisions, std::vector<std::vector<int>>& rows);
+
     private:
         Grammar& grammar;
         std::string output_file_name;
+        GeneratorOptions options;
+        FileSink file_sink;
+        OutputSink& sink;
+        bool succeeded = false;
 
         bool generate();
-        bool generate_header_file();
-        bool generate_source_file();
-        bool generate_production_code(std::ofstream& code_file, EBNFToken* ebnf_token, int indentation_level);
+        bool generate_header_file(std::ostream& header_file);
+        bool generate_source_file(std::ostream& code_file);
+        bool generate_parse_functions(std::ostream& code_file);
+        bool generate_production_code(std::ostream& code_file, int node_index, int indentation_level);
+        // Report a syntax error, and with error recovery jump to the end of the current parse function
+        void generate_error_code(std::ostream& code_file, const std::string& expected_value, int indentation_level);
+        void generate_table_error_code(std::ostream& code_file, int indentation_level);
+        void generate_follow_sets(std::ostream& code_file);
+        // Initializer of a uint64_t array holding a set as a bitmask
+        std::string bitmask_words(const SymbolSet& symbol_set, int word_count);
+        // Report First/First conflicts between the alternatives of an OR
+        static bool check_alternatives(Grammar& grammar, int node_index);
+        bool generate_parse_tables(std::ostream& code_file);
+        void generate_table_driver(std::ostream& code_file);
+        // Automaton and token types used by DFALexer
+        bool generate_lexer_tables(std::ostream& code_file);
+        // Functions reparse() uses to parse one nonterminal again, reusing the old nodes around it
+        void generate_reparse_functions(std::ostream& code_file);
+
+        // Nonterminal of the parse function being generated, and whether it needs a label to jump to after an error
+        int current_nonterminal_id = -1;
+        bool has_recovery_label = false;
+
+        // Name of the TokenKind enumerator for each terminal ID
+        std::vector<std::string> token_kind_names;
+        // Name of the NonterminalKind enumerator for each nonterminal ID
+        std::vector<std::string> nonterminal_kind_names;
+
+        void create_kind_names();
+        std::string create_kind_name(const std::string& prefix, const std::string& symbol, int id, std::set<std::string>& used_names);
+        void generate_kind_enums(std::ostream& header_file);
+        void generate_classify_token_function(std::ostream& code_file);
+        // Hash of a lexeme used to find a perfect hash of the terminals, the same as the generated terminal_hash()
+        uint32_t terminal_hash(const std::string& lexeme, uint32_t seed);
+        // Slot of a hash moved by its bucket's displacement, the same as the generated terminal_displace()
+        uint32_t terminal_displace(uint32_t hash, uint32_t displacement);
+        // Hash and displace: find a seed, and a displacement for each bucket, giving every terminal its own slot in a
+        // table of O(n) size. False if none is found, when the caller falls back to a sorted table
+        bool build_terminal_hash(const std::vector<int>& literal_terminals, uint32_t& seed, std::vector<int>& slots, std::vector<uint32_t>& displacements);
+        void generate_node_kind_label_function(std::ostream& code_file);
+        bool needs_node_kind_labels();
+        // Type of a parse tree node in the generated parser
+        std::string tree_node_type();
+        // Condition that a kind is an identifier or constant, whose lexeme is kept as a child in the tree
+        std::string lexeme_kind_condition(const std::string& kind);
+        // Name of the parser class template. output_file_name is its VirtualLexer instantiation
+        std::string parser_class_name();
+        // Parameter list of the parse functions, which take the parent node when building a tree
+        std::string parse_function_parameters();
+        // Add a terminal to the parse tree, where next_token is the matched token
+        void generate_leaf_code(std::ostream& code_file, int terminal_id, int indentation_level);
+        void generate_tree_gnu_plot_function(std::ostream& code_file);
+        void generate_flat_tree_gnu_plot_function(std::ostream& code_file);
+        // Result struct and parse_files() function template, which parses many files at once with one parser each
+        void generate_parse_files_function(std::ostream& header_file);
+        // Bitmasks of the kinds that can start each REPEAT and OPTIONAL with more than one choice
+        void generate_lookahead_sets(std::ostream& code_file);
+        // Condition testing next_token against a First set, without epsilon
+        std::string lookahead_condition(int node_index, const SymbolSet& first_set);
+        std::string escape_string(const std::string& value);
+        // Name used in a TokenKind enumerator for a character which cannot appear in an identifier
+        std::string character_name(char c);
 
         // Add the indentation before a line of code
-        void indent(std::ofstream& file, int level);
+        void indent(std::ostream& file, int level);
     };
 
 } // namespace ParserGenerator
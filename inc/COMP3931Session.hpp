@@ -0,0 +1,76 @@
+#ifndef __COMP3931_SESSION_HEADER__
+#define __COMP3931_SESSION_HEADER__
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "COMP3931Grammar.hpp"
+#include "COMP3931OutputSink.hpp"
+#include "COMP3931ParserGenerator.hpp"
+
+namespace ParserGenerator {
+
+    // A warning or error logged while working on a grammar
+    struct Diagnostic {
+        enum Severity {
+            WARNING,
+            // Also used for critical messages
+            ERROR
+        };
+
+        Severity severity;
+        std::string message;
+    };
+
+    // Outcome of one step of a Session, with every warning and error logged during it
+    struct Result {
+        // The step finished and no errors were logged
+        bool succeeded = false;
+        std::vector<Diagnostic> diagnostics;
+
+        int get_error_count() const;
+        int get_warning_count() const;
+    };
+
+    // Generates parsers in process, so a program can generate many of them without starting the generator each time.
+    // A Session holds one grammar, which is loaded, finalized, validated and then generated from any number of times.
+    // Messages still go to spdlog's default logger too. Each step replaces the process wide default logger while it runs
+    // in order to collect them, so only one step of any Session runs at a time and steps on other threads wait for it.
+    // Anything another thread logs through the default logger during a step is collected into that step's Result. Each
+    // Session must still only be used from one thread at a time
+    class Session {
+    public:
+        Session();
+        ~Session();
+
+        // Each load replaces the grammar held by the Session
+        Result load_file(const std::string& file_path);
+        // The contents are parsed straight away, so need not outlive the call
+        Result load_string(std::string_view contents);
+        // Load and finalize a grammar file, through its grammar cache if use_cache is set. See Grammar::input_finalized_language()
+        Result load_finalized_file(const std::string& file_path, bool use_cache = true);
+
+        // Does nothing if the grammar is already final
+        Result finalize();
+        // Check that the grammar can be generated with the options, finalizing it first if needed
+        Result validate(const GeneratorOptions& options = GeneratorOptions());
+        // Generate <name>.hpp and .cpp into sink, or write them with a FileSink if it is nullptr. Finalizes the grammar first if needed
+        Result generate(const std::string& name, const GeneratorOptions& options = GeneratorOptions(), OutputSink* sink = nullptr);
+
+        bool has_grammar();
+        // Only valid after a load
+        Grammar& get_grammar();
+
+    private:
+        std::unique_ptr<Grammar> grammar;
+
+        // Check a grammar has been loaded, reporting an error for step if not
+        bool check_loaded(const char* step);
+        bool finalize_if_needed();
+    };
+
+} // namespace ParserGenerator
+
+#endif
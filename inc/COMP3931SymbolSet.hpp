@@ -0,0 +1,52 @@
+#ifndef __COMP3931_SYMBOLSET_HEADER__
+#define __COMP3931_SYMBOLSET_HEADER__
+
+#include <cstdint>
+#include <vector>
+
+namespace ParserGenerator {
+
+    // Fixed-width bitset of terminal IDs used for First and Follow sets
+    class SymbolSet {
+    public:
+        SymbolSet();
+        explicit SymbolSet(int width);
+        // Copy a set of this width stored as its words, e.g. by get_words()
+        SymbolSet(int width, const uint64_t* words);
+
+        int get_width() const;
+
+        // Returns true if the symbol was not already in the set
+        bool insert(int symbol_id);
+        void erase(int symbol_id);
+        bool contains(int symbol_id) const;
+
+        // Add every symbol of other to this set. Returns true if this set changed
+        bool unite(const SymbolSet& other);
+        bool intersects(const SymbolSet& other) const;
+        // Lowest symbol ID in both sets, or -1 if they are disjoint
+        int first_common(const SymbolSet& other) const;
+
+        bool empty() const;
+        int size() const;
+        void clear();
+
+        // Lowest symbol ID >= from in the set, or -1 if there is none
+        int next(int from) const;
+        std::vector<int> to_vector() const;
+
+        const std::vector<uint64_t>& get_words() const;
+
+        bool operator==(const SymbolSet& other) const;
+        bool operator!=(const SymbolSet& other) const;
+
+    private:
+        int width;
+        std::vector<uint64_t> words;
+
+        void grow(int new_width);
+    };
+
+} // namespace ParserGenerator
+
+#endif
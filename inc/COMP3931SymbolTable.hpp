@@ -0,0 +1,49 @@
+#ifndef __COMP3931_SYMBOLTABLE_HEADER__
+#define __COMP3931_SYMBOLTABLE_HEADER__
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ParserGenerator {
+
+    // Interns terminal and nonterminal names as dense integer IDs
+    // Terminals and nonterminals have separate ID spaces, both starting at 0
+    class SymbolTable {
+    public:
+        // Reserved terminal IDs
+        static const int EPSILON_ID = 0;
+        static const int EOF_ID = 1;
+
+        SymbolTable();
+
+        // The maps hold views of the stored names, so a copy would point into the original
+        SymbolTable(const SymbolTable&) = delete;
+        SymbolTable& operator=(const SymbolTable&) = delete;
+
+        // Both return the ID of the symbol, which is the existing ID if it was already added
+        int add_terminal(const std::string& name);
+        int add_nonterminal(const std::string& name);
+
+        // Both return -1 if the symbol has not been added
+        int get_terminal_id(std::string_view name) const;
+        int get_nonterminal_id(std::string_view name) const;
+
+        const std::string& get_terminal_name(int id) const;
+        const std::string& get_nonterminal_name(int id) const;
+
+        int get_terminal_count() const;
+        int get_nonterminal_count() const;
+
+    private:
+        // The maps are keyed by views of the names, so the names are kept in deques which never move their elements
+        std::deque<std::string> terminal_names;
+        std::deque<std::string> nonterminal_names;
+        std::unordered_map<std::string_view, int> terminal_ids;
+        std::unordered_map<std::string_view, int> nonterminal_ids;
+    };
+
+} // namespace ParserGenerator
+
+#endif
@@ -10,7 +10,7 @@ using namespace ParserGenerator;
  * EBNFToken Class
  */
 
-EBNFToken::EBNFToken(TokenType type, std::string value) : type(type), value(value) {
+EBNFToken::EBNFToken(TokenType type, std::string value, int symbol_id) : type(type), value(value), symbol_id(symbol_id), ir_index(-1) {
 
 }
 
@@ -28,6 +28,22 @@ std::string EBNFToken::get_value() {
     return value;
 }
 
+int EBNFToken::get_symbol_id() {
+    return symbol_id;
+}
+
+void EBNFToken::set_symbol_id(int new_symbol_id) {
+    symbol_id = new_symbol_id;
+}
+
+int EBNFToken::get_ir_index() {
+    return ir_index;
+}
+
+void EBNFToken::set_ir_index(int new_ir_index) {
+    ir_index = new_ir_index;
+}
+
 void EBNFToken::add_child(EBNFToken* new_child) {
     if (new_child == nullptr || new_child == NULL) {
         return;
@@ -1,17 +1,89 @@
 #include <algorithm>
-#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <list>
 #include <set>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "COMP3931Grammar.hpp"
 #include "COMP3931EBNFToken.hpp"
+#include "COMP3931InputBuffer.hpp"
+#include "COMP3931Logging.hpp"
+#include "COMP3931OutputSink.hpp"
 #include "spdlog/spdlog.h"
 
 using namespace ParserGenerator;
 
+namespace {
+    // Grammar cache layout: a CacheHeader, then the arrays in the order the header lists them, then the symbol names
+    // one after another. Everything is in the byte order and layout of the machine that wrote it
+    const char CACHE_MAGIC[8] = {'C', '3', '9', '3', '1', 'G', 'C', '\0'};
+    const uint32_t CACHE_VERSION = 2;
+    const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t content_hash;
+        // hash_contents() of everything after the header, so a damaged cache is found even where its values are valid
+        uint64_t payload_hash;
+        uint64_t file_size;
+        // End of each name in the names, terminals then nonterminals
+        uint32_t terminal_count;
+        uint32_t nonterminal_count;
+        // IR nodes as four int32_t each, then the root and end of each production
+        uint32_t node_count;
+        uint32_t production_count;
+        int32_t start_symbol_id;
+        // Words of each set, all of which are terminal_count wide. The sets are the First set of each IR node, then
+        // of each nonterminal, then the Follow set of each nonterminal
+        uint32_t set_words;
+        uint64_t names_size;
+    };
+
+    // 64 bit FNV-1a
+    uint64_t hash_contents(std::string_view contents) {
+        uint64_t hash = 0xcbf29ce484222325;
+
+        for (char c : contents) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3;
+        }
+
+        return hash;
+    }
+
+    // Hands out consecutive pieces of the cache, or nullptr once a piece would run past the end
+    class CacheReader {
+    public:
+        CacheReader(std::string_view contents) : contents(contents), position(0) {}
+
+        const char* take(uint64_t size) {
+            if (size > contents.size() - position) {
+                return nullptr;
+            }
+
+            const char* piece = contents.data() + position;
+            position += size;
+            return piece;
+        }
+
+    private:
+        std::string_view contents;
+        size_t position;
+    };
+
+    template <typename T>
+    void write_array(std::string& contents, const std::vector<T>& values) {
+        contents.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+} // namespace
+
 /*
  * Grammar Class
  */
@@ -31,20 +103,56 @@ Grammar::~Grammar() {
 }
 
 bool Grammar::input_language_from_file(std::string file_path) {
-    std::ifstream input_file(file_path);
-
-    if (input_file.is_open()) {
-        spdlog::trace("Opened file {} for parsing as a grammar definition", file_path);
+    InputBuffer input_file;
 
-        file_parse_INPUT_FILE(input_file);
+    if (input_file.open_file(file_path)) {
+        COMP3931_TRACE("Opened file {} for parsing as a grammar definition", file_path);
 
-        return true;
+        return file_parse_INPUT_FILE(input_file);
     } else {
         spdlog::error("Cannot open input file: {}", file_path);
         return false;
     }
 }
 
+bool Grammar::input_language_from_string(std::string_view contents) {
+    InputBuffer input;
+
+    input.open_string(contents);
+    COMP3931_TRACE("Parsing {} bytes of text as a grammar definition", contents.size());
+
+    return file_parse_INPUT_FILE(input);
+}
+
+bool Grammar::input_finalized_language(std::string file_path, bool use_cache) {
+    InputBuffer input_file;
+
+    if (!input_file.open_file(file_path)) {
+        spdlog::error("Cannot open input file: {}", file_path);
+        return false;
+    }
+
+    std::string cache_path = file_path + ".cache";
+    uint64_t content_hash = hash_contents(input_file.get_contents());
+
+    if (use_cache && read_cache(cache_path, content_hash)) {
+        spdlog::info("Loaded finalized grammar from `{}`", cache_path);
+        return true;
+    }
+
+    COMP3931_TRACE("Opened file {} for parsing as a grammar definition", file_path);
+
+    bool parsed = file_parse_INPUT_FILE(input_file);
+    bool finalized = finalize_grammar();
+
+    // A grammar with errors is parsed again each time, so the errors are reported each time
+    if (use_cache && parsed && finalized) {
+        write_cache(cache_path, content_hash);
+    }
+
+    return parsed && finalized;
+}
+
 bool Grammar::add_terminal(std::string new_terminal) {
     if (new_terminal == "eof") {
         spdlog::error("Attempting to add terminal `{}` not allowed. Please see README.md section `Non-Allowed symbols`", new_terminal);
@@ -60,6 +168,8 @@ bool Grammar::add_terminal(std::string new_terminal) {
 
     if (ret.second == false) {
         spdlog::warn("Found duplicate definition of terminal `{}`. Ignoring second definition", new_terminal);
+    } else {
+        symbol_table.add_terminal(new_terminal);
     }
 
     return true;
@@ -85,6 +195,7 @@ bool Grammar::add_nonterminal(std::string new_nonterminal) {
     } else {
         // Initialise production map for this nonterminal
         production_rules.insert({new_nonterminal, nullptr});
+        symbol_table.add_nonterminal(new_nonterminal);
     }
 
     return true;
@@ -94,7 +205,7 @@ std::set<std::string>& Grammar::get_nonterminals() { return nonterminals; }
 
 bool Grammar::add_production(std::string nonterminal, EBNFToken* new_production) {
     if (start_symbol == "") {
-        spdlog::trace("Inferring start symbol as `{}`", nonterminal);
+        COMP3931_TRACE("Inferring start symbol as `{}`", nonterminal);
         set_start_symbol(nonterminal);
     }
 
@@ -131,18 +242,49 @@ bool Grammar::set_start_symbol(std::string new_start_symbol) {
 
 std::string Grammar::get_start_symbol() { return start_symbol; }
 
-bool Grammar::is_terminal(std::string to_find) {
-    return !(terminals.find(to_find) == terminals.end());
+bool Grammar::is_terminal(std::string_view to_find) {
+    // eof has a reserved ID but is not a terminal of the grammar
+    int terminal_id = symbol_table.get_terminal_id(to_find);
+    return terminal_id != -1 && terminal_id != SymbolTable::EOF_ID;
 }
 
-bool Grammar::is_nonterminal(std::string to_find) {
-    return !(nonterminals.find(to_find) == nonterminals.end());
+bool Grammar::is_nonterminal(std::string_view to_find) {
+    return symbol_table.get_nonterminal_id(to_find) != -1;
 }
 
-void Grammar::finalize_grammar() {
-    calculate_all_first_sets();
-    calculate_all_follow_sets();
+SymbolTable& Grammar::get_symbol_table() { return symbol_table; }
+
+GrammarIR& Grammar::get_ir() { return ir; }
+
+bool Grammar::finalize_grammar() {
+    // Compile the production trees into the IR, in nonterminal ID order, so the analysis never follows a pointer or looks up a name
+    ir.clear();
+    bool finalized = true;
+
+    for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+        std::unordered_map<std::string, EBNFToken*>::iterator production = production_rules.find(symbol_table.get_nonterminal_name(nonterminal_id));
+
+        if (production == production_rules.end() || production->second == nullptr) {
+            continue;
+        }
+
+        if (!resolve_symbol_ids(production->second)) {
+            finalized = false;
+            continue;
+        }
+
+        ir.add_production(nonterminal_id, production->second);
+    }
+
+    first_set_calculations = 0;
+    finalized = calculate_all_first_sets() && finalized;
+
+    COMP3931_DEBUG("Calculated First sets of IR nodes {} times", first_set_calculations);
+
+    finalized = calculate_all_follow_sets() && finalized;
     is_final = true;
+
+    return finalized;
 }
 
 bool Grammar::get_is_final() { return is_final; }
@@ -168,70 +310,409 @@ void Grammar::log_grammar() {
     // Log productions
     spdlog::info("Production Rules:");
 
-    for (std::pair<std::string, EBNFToken*> production : production_rules) {
-        if (production.second != nullptr) {
-            spdlog::info("{} ::= {}", production.first, production.second->to_string());
-        } else {
-            spdlog::info("{} ::=", production.first);
+    // A grammar loaded from a cache only has the IR, which prints the same as the production trees
+    if (is_final) {
+        for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+            int production = ir.get_production(nonterminal_id);
+
+            if (production != -1) {
+                spdlog::info("{} ::= {}", symbol_table.get_nonterminal_name(nonterminal_id), ir.to_string(production, symbol_table));
+            } else {
+                spdlog::info("{} ::=", symbol_table.get_nonterminal_name(nonterminal_id));
+            }
+        }
+    } else {
+        for (std::pair<std::string, EBNFToken*> production : production_rules) {
+            if (production.second != nullptr) {
+                spdlog::info("{} ::= {}", production.first, production.second->to_string());
+            } else {
+                spdlog::info("{} ::=", production.first);
+            }
         }
     }
 
     // Log first set
     spdlog::info("First sets:");
 
-    for (std::pair<std::string, std::set<std::string>> first_set : first_sets) {
-        std::string first_set_list = "";
-
-        for (std::string terminal : first_set.second) {
-            first_set_list += terminal;
-            first_set_list += ", ";
-        }
+    for (const std::string& terminal : terminals) {
+        spdlog::info("First({}) = {}, ", terminal, terminal);
+    }
 
-        spdlog::info("First({}) = {}", first_set.first, first_set_list);
+    for (size_t i = 0; i < first_sets.size(); i++) {
+        spdlog::info("First({}) = {}", symbol_table.get_nonterminal_name(i), symbol_set_to_string(first_sets[i]));
     }
 
     // Log follow set
     spdlog::info("Follow sets:");
 
-    for (std::pair<std::string, std::set<std::string>> follow_set : follow_sets) {
-        std::string follow_set_list = "";
-
-        for (std::string terminal : follow_set.second) {
-            follow_set_list += terminal;
-            follow_set_list += ", ";
-        }
-
-        spdlog::info("Follow({}) = {}", follow_set.first, follow_set_list);
+    for (size_t i = 0; i < follow_sets.size(); i++) {
+        spdlog::info("Follow({}) = {}", symbol_table.get_nonterminal_name(i), symbol_set_to_string(follow_sets[i]));
     }
 }
 
 std::set<std::string> Grammar::calculate_first_set(EBNFToken* ebnf_token) {
-    return calculate_first_terminal(ebnf_token);
+    return symbol_set_to_strings(calculate_first_bits(ebnf_token));
 }
 
 std::set<std::string> Grammar::get_first_set(std::string symbol) {
-    std::unordered_map<std::string, std::set<std::string>>::const_iterator first_itr = first_sets.find(symbol);
+    if (is_terminal(symbol)) {
+        // First(terminal) = {terminal}
+        return std::set<std::string>({symbol});
+    }
 
-    if (first_itr == first_sets.end()) {
+    int nonterminal_id = symbol_table.get_nonterminal_id(symbol);
+
+    if (nonterminal_id == -1 || nonterminal_id >= static_cast<int>(first_sets.size())) {
         return std::set<std::string>();
     } else {
-        return first_itr->second;
+        return symbol_set_to_strings(first_sets[nonterminal_id]);
     }
 }
 
 std::set<std::string> Grammar::get_follow_set(std::string nonterminal) {
-    std::unordered_map<std::string, std::set<std::string>>::const_iterator follow_itr = follow_sets.find(nonterminal);
+    int nonterminal_id = symbol_table.get_nonterminal_id(nonterminal);
 
-    if (follow_itr == follow_sets.end()) {
+    if (nonterminal_id == -1 || nonterminal_id >= static_cast<int>(follow_sets.size())) {
         return std::set<std::string>();
     } else {
-        return follow_itr->second;
+        return symbol_set_to_strings(follow_sets[nonterminal_id]);
+    }
+}
+
+SymbolSet Grammar::calculate_first_bits(EBNFToken* ebnf_token) {
+    if (ebnf_token == nullptr || ebnf_token->get_ir_index() == -1 || ebnf_token->get_ir_index() >= ir.get_node_count()) {
+        spdlog::error("First set requested for an EBNF token which is not part of the finalized grammar");
+        return SymbolSet(symbol_table.get_terminal_count());
     }
+
+    return ir.get_first_set(ebnf_token->get_ir_index());
 }
 
-bool Grammar::file_parse_INPUT_FILE(std::ifstream& input) {
+const SymbolSet& Grammar::get_first_set(int nonterminal_id) { return first_sets[nonterminal_id]; }
+
+const SymbolSet& Grammar::get_follow_set(int nonterminal_id) { return follow_sets[nonterminal_id]; }
+
+int Grammar::get_first_set_calculations() { return first_set_calculations; }
+
+int Grammar::get_follow_production_visits() { return follow_production_visits; }
+
+int Grammar::get_follow_visits_saved() { return follow_visits_saved; }
+
+std::set<std::string> Grammar::symbol_set_to_strings(const SymbolSet& symbol_set) {
+    std::set<std::string> names;
+
+    for (int id = symbol_set.next(0); id != -1; id = symbol_set.next(id + 1)) {
+        names.insert(symbol_table.get_terminal_name(id));
+    }
+
+    return names;
+}
+
+std::string Grammar::symbol_set_to_string(const SymbolSet& symbol_set) {
+    std::string symbol_list = "";
+
+    // Go through the std::set so the output stays in alphabetical order
+    for (const std::string& terminal : symbol_set_to_strings(symbol_set)) {
+        symbol_list += terminal;
+        symbol_list += ", ";
+    }
+
+    return symbol_list;
+}
+
+bool Grammar::read_cache(const std::string& cache_path, uint64_t content_hash) {
+    InputBuffer cache_file;
+
+    if (!cache_file.open_file(cache_path)) {
+        COMP3931_DEBUG("No grammar cache at `{}`", cache_path);
+        return false;
+    }
+
+    CacheReader reader(cache_file.get_contents());
+    CacheHeader header;
+    const char* header_data = reader.take(sizeof(CacheHeader));
+
+    if (header_data == nullptr) {
+        spdlog::warn("Grammar cache `{}` is too short, so the grammar is read again", cache_path);
+        return false;
+    }
+
+    std::memcpy(&header, header_data, sizeof(CacheHeader));
+
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION || header.byte_order != CACHE_BYTE_ORDER || header.file_size != cache_file.get_size()) {
+        spdlog::warn("Grammar cache `{}` was not written by this version or is damaged, so the grammar is read again", cache_path);
+        return false;
+    }
+
+    if (header.content_hash != content_hash) {
+        COMP3931_DEBUG("Grammar cache `{}` is for other contents", cache_path);
+        return false;
+    }
+
+    // Everything is decoded into locals and checked before the grammar is changed, so a damaged cache leaves it empty
+    auto damaged = [&cache_path]() {
+        spdlog::warn("Grammar cache `{}` is damaged, so the grammar is read again", cache_path);
+        return false;
+    };
+
+    if (header.payload_hash != hash_contents(cache_file.get_contents().substr(sizeof(CacheHeader)))) {
+        return damaged();
+    }
+
+    // The terminals every grammar starts with are already in the table
+    uint32_t existing_terminals = symbol_table.get_terminal_count();
+
+    if (header.terminal_count < existing_terminals || header.set_words != (uint64_t(header.terminal_count) + 63) / 64 || symbol_table.get_nonterminal_count() != 0) {
+        return damaged();
+    }
+
+    uint64_t symbol_count = uint64_t(header.terminal_count) + header.nonterminal_count;
+    uint64_t set_count = uint64_t(header.node_count) + 2 * uint64_t(header.nonterminal_count);
+    const char* name_ends_data = reader.take(symbol_count * sizeof(uint32_t));
+    const char* nodes_data = reader.take(uint64_t(header.node_count) * 4 * sizeof(int32_t));
+    const char* productions_data = reader.take(uint64_t(header.production_count) * 2 * sizeof(int32_t));
+    const char* sets_data = reader.take(set_count * header.set_words * sizeof(uint64_t));
+    const char* names = reader.take(header.names_size);
+
+    if (name_ends_data == nullptr || nodes_data == nullptr || productions_data == nullptr || sets_data == nullptr || names == nullptr) {
+        return damaged();
+    }
+
+    // Each piece fits in the file, so the counts all fit in an int
+    int terminal_count = header.terminal_count;
+    int nonterminal_count = header.nonterminal_count;
+    int node_count = header.node_count;
+    int production_count = header.production_count;
+
+    std::vector<uint32_t> name_ends(symbol_count);
+    std::memcpy(name_ends.data(), name_ends_data, symbol_count * sizeof(uint32_t));
+    std::vector<std::string> symbol_names;
+    std::set<std::string> terminal_names;
+    std::set<std::string> nonterminal_names;
+    uint32_t name_start = 0;
+
+    for (uint64_t i = 0; i < symbol_count; i++) {
+        if (name_ends[i] > header.names_size || name_ends[i] < name_start) {
+            return damaged();
+        }
+
+        symbol_names.emplace_back(names + name_start, name_ends[i] - name_start);
+        name_start = name_ends[i];
+
+        // Symbols keep their IDs, so the names must be unique and start with the terminals already in the table
+        bool is_new = i < header.terminal_count ? terminal_names.insert(symbol_names.back()).second : nonterminal_names.insert(symbol_names.back()).second;
+
+        if (!is_new || (i < existing_terminals && symbol_names.back() != symbol_table.get_terminal_name(i))) {
+            return damaged();
+        }
+    }
+
+    if (header.start_symbol_id < -1 || header.start_symbol_id >= nonterminal_count) {
+        return damaged();
+    }
+
+    std::vector<int32_t> node_values(uint64_t(node_count) * 4);
+    std::memcpy(node_values.data(), nodes_data, node_values.size() * sizeof(int32_t));
+    std::vector<GrammarIR::Node> nodes(node_count);
+
+    for (int i = 0; i < node_count; i++) {
+        int32_t type = node_values[4 * i];
+        int32_t symbol_id = node_values[4 * i + 1];
+        int32_t first_child = node_values[4 * i + 2];
+        int32_t child_count = node_values[4 * i + 3];
+
+        if (type < EBNFToken::SEQUENCE || type > EBNFToken::GROUP) {
+            return damaged();
+        }
+
+        if ((type == EBNFToken::TERMINAL && (symbol_id < 0 || symbol_id >= terminal_count)) || (type == EBNFToken::NONTERMINAL && (symbol_id < 0 || symbol_id >= nonterminal_count))) {
+            return damaged();
+        }
+
+        // Children always come after their node, which also rules out cycles
+        if (child_count < 0 || first_child < 0 || int64_t(first_child) + child_count > node_count || (child_count > 0 && first_child <= i)) {
+            return damaged();
+        }
+
+        nodes[i] = {static_cast<EBNFToken::TokenType>(type), symbol_id, first_child, child_count};
+    }
+
+    std::vector<int> production_roots(production_count);
+    std::vector<int> production_ends(production_count);
+    std::memcpy(production_roots.data(), productions_data, production_count * sizeof(int32_t));
+    std::memcpy(production_ends.data(), productions_data + production_count * sizeof(int32_t), production_count * sizeof(int32_t));
+
+    if (production_count > nonterminal_count) {
+        return damaged();
+    }
+
+    for (int i = 0; i < production_count; i++) {
+        bool no_production = production_roots[i] == -1 && production_ends[i] == -1;
+
+        if (!no_production && (production_roots[i] < 0 || production_roots[i] >= production_ends[i] || production_ends[i] > node_count)) {
+            return damaged();
+        }
+    }
+
+    // The sets are copied out a word array at a time. Bits past the last terminal must be clear, or they would be
+    // read back as terminals which do not exist
+    std::vector<uint64_t> words(set_count * header.set_words);
+    std::memcpy(words.data(), sets_data, words.size() * sizeof(uint64_t));
+    uint64_t unused_bits = terminal_count % 64 == 0 ? 0 : ~uint64_t(0) << (terminal_count % 64);
+
+    for (uint64_t i = header.set_words - 1; i < words.size(); i += header.set_words) {
+        if ((words[i] & unused_bits) != 0) {
+            return damaged();
+        }
+    }
+
+    const uint64_t* set_words = words.data();
+    std::vector<SymbolSet> node_first_sets;
+    std::vector<SymbolSet> new_first_sets;
+    std::vector<SymbolSet> new_follow_sets;
+    node_first_sets.reserve(node_count);
+
+    for (int i = 0; i < node_count; i++, set_words += header.set_words) {
+        node_first_sets.emplace_back(terminal_count, set_words);
+    }
+
+    for (int i = 0; i < nonterminal_count; i++, set_words += header.set_words) {
+        new_first_sets.emplace_back(terminal_count, set_words);
+    }
+
+    for (int i = 0; i < nonterminal_count; i++, set_words += header.set_words) {
+        new_follow_sets.emplace_back(terminal_count, set_words);
+    }
+
+    // Only now is the grammar changed
+    for (int id = 0; id < terminal_count; id++) {
+        symbol_table.add_terminal(symbol_names[id]);
+
+        if (id != SymbolTable::EOF_ID) {
+            terminals.insert(symbol_names[id]);
+        }
+    }
+
+    for (int id = 0; id < nonterminal_count; id++) {
+        const std::string& name = symbol_names[terminal_count + id];
+
+        symbol_table.add_nonterminal(name);
+        nonterminals.insert(name);
+        production_rules.insert({name, nullptr});
+    }
+
+    if (header.start_symbol_id != -1) {
+        start_symbol = symbol_table.get_nonterminal_name(header.start_symbol_id);
+    }
+
+    first_sets = std::move(new_first_sets);
+    follow_sets = std::move(new_follow_sets);
+    ir.assign(std::move(nodes), std::move(node_first_sets), std::move(production_roots), std::move(production_ends));
+    is_final = true;
+
+    return true;
+}
+
+bool Grammar::write_cache(const std::string& cache_path, uint64_t content_hash) {
+    int terminal_count = symbol_table.get_terminal_count();
+    int nonterminal_count = symbol_table.get_nonterminal_count();
+    int set_words = (terminal_count + 63) / 64;
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.content_hash = content_hash;
+    header.terminal_count = terminal_count;
+    header.nonterminal_count = nonterminal_count;
+    header.node_count = ir.get_node_count();
+    header.production_count = ir.get_production_count();
+    header.start_symbol_id = symbol_table.get_nonterminal_id(start_symbol);
+    header.set_words = set_words;
+
+    std::string names;
+    std::vector<uint32_t> name_ends;
+
+    for (int id = 0; id < terminal_count; id++) {
+        names += symbol_table.get_terminal_name(id);
+        name_ends.push_back(names.size());
+    }
+
+    for (int id = 0; id < nonterminal_count; id++) {
+        names += symbol_table.get_nonterminal_name(id);
+        name_ends.push_back(names.size());
+    }
+
+    std::vector<int32_t> node_values;
+    std::vector<int32_t> productions;
+
+    for (int i = 0; i < ir.get_node_count(); i++) {
+        const GrammarIR::Node& node = ir.get_node(i);
+        node_values.insert(node_values.end(), {static_cast<int32_t>(node.type), node.symbol_id, node.first_child, node.child_count});
+    }
+
+    for (int i = 0; i < ir.get_production_count(); i++) {
+        productions.push_back(ir.get_production(i));
+    }
+
+    for (int i = 0; i < ir.get_production_count(); i++) {
+        productions.push_back(ir.get_production_end(i));
+    }
+
+    // Every set has the same number of words, so the sets can be found without storing their sizes
+    std::vector<uint64_t> words;
+    std::vector<const SymbolSet*> sets;
+
+    for (int i = 0; i < ir.get_node_count(); i++) {
+        sets.push_back(&ir.get_first_set(i));
+    }
+
+    for (const SymbolSet& first_set : first_sets) {
+        sets.push_back(&first_set);
+    }
+
+    for (const SymbolSet& follow_set : follow_sets) {
+        sets.push_back(&follow_set);
+    }
+
+    for (const SymbolSet* symbol_set : sets) {
+        if (symbol_set->get_width() != terminal_count) {
+            spdlog::warn("Not writing grammar cache `{}` as a set has the wrong width", cache_path);
+            return false;
+        }
+
+        words.insert(words.end(), symbol_set->get_words().begin(), symbol_set->get_words().end());
+    }
+
+    header.names_size = names.size();
+    header.file_size = sizeof(CacheHeader) + name_ends.size() * sizeof(uint32_t) + node_values.size() * sizeof(int32_t) + productions.size() * sizeof(int32_t) + words.size() * sizeof(uint64_t) + names.size();
+
+    // Built in memory and written with replace_file(), so a run stopped part way never leaves a cache half written
+    std::string contents;
+    contents.reserve(header.file_size);
+    contents.append(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+    write_array(contents, name_ends);
+    write_array(contents, node_values);
+    write_array(contents, productions);
+    write_array(contents, words);
+    contents.append(names);
+
+    header.payload_hash = hash_contents(std::string_view(contents).substr(sizeof(CacheHeader)));
+    std::memcpy(&contents[0], &header, sizeof(CacheHeader));
+
+    if (!replace_file(cache_path, contents, spdlog::level::warn)) {
+        spdlog::warn("Could not write grammar cache `{}`", cache_path);
+        return false;
+    }
+
+    COMP3931_DEBUG("Wrote grammar cache `{}` of {} bytes", cache_path, header.file_size);
+
+    return true;
+}
+
+bool Grammar::file_parse_INPUT_FILE(InputBuffer& input) {
     spdlog::info("Parsing terminals");
-    spdlog::trace("Parsing INPUT_FILE");
+    COMP3931_TRACE("Parsing INPUT_FILE");
 
     if (!file_parse_TERM_DECLAR(input)) {
         return false;
@@ -242,17 +723,17 @@ bool Grammar::file_parse_INPUT_FILE(std::ifstream& input) {
         if (c == '\r') {
             // NOTE: Windows line endings
             if (!input.get(c)) {
-                spdlog::error("Error reading file after parsing terminal declaration at position {}", input.tellg());
+                spdlog::error("Error reading file after parsing terminal declaration at {}", input.describe_position());
                 return false;
             }
 
             if (c != '\n') {
-                spdlog::error("Expected newline character at end of terminal declaration but found `{}` at position {}", c, input.tellg());
+                spdlog::error("Expected newline character at end of terminal declaration but found `{}` at {}", c, input.describe_position());
                 return false;
             }
         }
     } else {
-        spdlog::error("Error reading file after parsing terminal declaration at position {}", input.tellg());
+        spdlog::error("Error reading file after parsing terminal declaration at {}", input.describe_position());
         return false;
     }
 
@@ -266,17 +747,17 @@ bool Grammar::file_parse_INPUT_FILE(std::ifstream& input) {
         if (c == '\r') {
             // NOTE: Windows line endings
             if (!input.get(c)) {
-                spdlog::error("Error reading file after parsing nonterminal declaration at position {}", input.tellg());
+                spdlog::error("Error reading file after parsing nonterminal declaration at {}", input.describe_position());
                 return false;
             }
 
             if (c != '\n') {
-                spdlog::error("Expected newline character at end of nonterminal declaration but found `{}` at position {}", c, input.tellg());
+                spdlog::error("Expected newline character at end of nonterminal declaration but found `{}` at {}", c, input.describe_position());
                 return false;
             }
         }
     } else {
-        spdlog::error("Error reading file after parsing nonterminal declaration at position {}", input.tellg());
+        spdlog::error("Error reading file after parsing nonterminal declaration at {}", input.describe_position());
         return false;
     }
 
@@ -289,8 +770,8 @@ bool Grammar::file_parse_INPUT_FILE(std::ifstream& input) {
     return true;
 }
 
-bool Grammar::file_parse_TERM_DECLAR(std::ifstream& input) {
-    spdlog::trace("Parsing TERM_DECLAR");
+bool Grammar::file_parse_TERM_DECLAR(InputBuffer& input) {
+    COMP3931_TRACE("Parsing TERM_DECLAR");
 
     char c;
     int i;
@@ -303,10 +784,9 @@ bool Grammar::file_parse_TERM_DECLAR(std::ifstream& input) {
         return false;
     }
 
-    std::string new_terminal;
+    std::string_view new_terminal;
 
     do {
-        new_terminal = "";
 
         if (!file_parse_skip_white_space(input)) {
             return false;
@@ -314,7 +794,7 @@ bool Grammar::file_parse_TERM_DECLAR(std::ifstream& input) {
 
         i = input.peek();
         if (i == EOF) {
-            spdlog::error("Error reading file while parsing terminal declaration at position {}", input.tellg());
+            spdlog::error("Error reading file while parsing terminal declaration at {}", input.describe_position());
             return false;
         } else if (i == '\r' || i == '\n') {
             // End of terminal list
@@ -326,14 +806,14 @@ bool Grammar::file_parse_TERM_DECLAR(std::ifstream& input) {
         if (!file_parse_TERMINAL(input, new_terminal)) {
             return false;
         } else {
-            spdlog::trace("Found terminal `{}`", new_terminal);
-            add_terminal(new_terminal);
+            COMP3931_TRACE("Found terminal `{}`", new_terminal);
+            add_terminal(std::string(new_terminal));
         }
     } while(true);
 }
 
-bool Grammar::file_parse_NONTERM_DECLAR(std::ifstream& input) {
-    spdlog::trace("Parsing NONTERM_DECLAR");
+bool Grammar::file_parse_NONTERM_DECLAR(InputBuffer& input) {
+    COMP3931_TRACE("Parsing NONTERM_DECLAR");
 
     char c;
     int i;
@@ -350,10 +830,9 @@ bool Grammar::file_parse_NONTERM_DECLAR(std::ifstream& input) {
         return false;
     }
 
-    std::string new_nonterminal;
+    std::string_view new_nonterminal;
 
     do {
-        new_nonterminal = "";
 
         if (!file_parse_skip_white_space(input)) {
             return false;
@@ -361,7 +840,7 @@ bool Grammar::file_parse_NONTERM_DECLAR(std::ifstream& input) {
 
         i = input.peek();
         if (i == EOF) {
-            spdlog::error("Error reading file while parsing nonterminal declaration at position {}", input.tellg());
+            spdlog::error("Error reading file while parsing nonterminal declaration at {}", input.describe_position());
             return false;
         } else if (i == '\r' || i == '\n') {
             // End of nonterminal list
@@ -373,19 +852,24 @@ bool Grammar::file_parse_NONTERM_DECLAR(std::ifstream& input) {
         if (!file_parse_TERMINAL(input, new_nonterminal)) {
             return false;
         } else {
-            spdlog::trace("Found nonterminal `{}`", new_nonterminal);
-            add_nonterminal(new_nonterminal);
+            COMP3931_TRACE("Found nonterminal `{}`", new_nonterminal);
+            add_nonterminal(std::string(new_nonterminal));
         }
     } while(true);
 }
 
-bool Grammar::file_parse_TERMINAL(std::ifstream& input, std::string& terminal) {
-    spdlog::trace("Parsing TERMINAL");
+bool Grammar::file_parse_TERMINAL(InputBuffer& input, std::string_view& terminal) {
+    COMP3931_TRACE("Parsing TERMINAL");
 
     if (!file_parse_skip_white_space(input)) {
         return false;
     }
 
+    // The terminal is a slice of the input unless it contains escaped characters, in which case it is built up in unescaped
+    size_t terminal_start = input.get_position();
+    std::string unescaped;
+    bool has_escaped_chars = false;
+
     char c;
     int i = input.peek();
     bool escaped_char = false;
@@ -395,6 +879,11 @@ bool Grammar::file_parse_TERMINAL(std::ifstream& input, std::string& terminal) {
         if (!escaped_char && i == '\\') {
             escaped_char = true;
 
+            if (!has_escaped_chars) {
+                unescaped.assign(input.slice(terminal_start, input.get_position()));
+                has_escaped_chars = true;
+            }
+
             if (!file_parse_check_char(input, '\\')) {
                 return false;
             }
@@ -403,37 +892,45 @@ bool Grammar::file_parse_TERMINAL(std::ifstream& input, std::string& terminal) {
             escaped_char = false;
 
             if (!input.get(c)) {
-                spdlog::error("Error reading file while parsing terminal at position {}", input.tellg());
+                spdlog::error("Error reading file while parsing terminal at {}", input.describe_position());
                 return false;
             }
 
-            terminal += c;
+            unescaped += c;
         } else if (i == ',' || i == '{' || i == '}' || i == '[' || i == ']' || i == '(' || i == ')' || i == '\\' || i == '|') {
             // These characters can only appear when escaped, which it wasn't so must be the end of the terminal
-            return true;
+            break;
         } else {
             // Normal character
             if (!input.get(c)) {
-                spdlog::error("Error reading file while parsing terminal at position {}", input.tellg());
+                spdlog::error("Error reading file while parsing terminal at {}", input.describe_position());
                 return false;
             }
 
             if (escaped_char) {
-                spdlog::error("Unknown escaped sequence `\\{}` at position {}", c, input.tellg());
+                spdlog::error("Unknown escaped sequence `\\{}` at {}", c, input.describe_position());
                 return false;
             }
 
-            terminal += c;
+            if (has_escaped_chars) {
+                unescaped += c;
+            }
         }
 
         i = input.peek();
     }
 
+    if (has_escaped_chars) {
+        terminal = input.keep(std::move(unescaped));
+    } else {
+        terminal = input.slice(terminal_start, input.get_position());
+    }
+
     return true;
 }
 
-bool Grammar::file_parse_GRAM_DECLAR(std::ifstream& input) {
-    spdlog::trace("Parsing GRAM_DECLAR");
+bool Grammar::file_parse_GRAM_DECLAR(InputBuffer& input) {
+    COMP3931_TRACE("Parsing GRAM_DECLAR");
 
     int i;
 
@@ -455,7 +952,7 @@ bool Grammar::file_parse_GRAM_DECLAR(std::ifstream& input) {
         spdlog::warn("No production rules defined");
         return true;
     } else if (!(i == '\r' || i == '\n')) {
-        spdlog::error("Expected newline character for start of productions declaration but found `{}` at position {}", static_cast<char>(i), input.tellg());
+        spdlog::error("Expected newline character for start of productions declaration but found `{}` at {}", static_cast<char>(i), input.describe_position());
         return false;
     }
 
@@ -484,20 +981,20 @@ bool Grammar::file_parse_GRAM_DECLAR(std::ifstream& input) {
     return true;
 }
 
-bool Grammar::file_parse_PRODUCTION(std::ifstream& input) {
-    spdlog::trace("Parsing PRODUCTION");
+bool Grammar::file_parse_PRODUCTION(InputBuffer& input) {
+    COMP3931_TRACE("Parsing PRODUCTION");
 
-    std::string new_lhs;
+    std::string_view new_lhs;
     EBNFToken* new_rhs = nullptr;
 
     if (!file_parse_LHS(input, new_lhs)) {
         return false;
     }
 
-    spdlog::trace("LHS of production `{}`", new_lhs);
+    COMP3931_TRACE("LHS of production `{}`", new_lhs);
 
     if (!is_nonterminal(new_lhs)) {
-        spdlog::error("Production for undelcared nonterminal `{}` at position", new_lhs, input.tellg());
+        spdlog::error("Production for undelcared nonterminal `{}` at {}", new_lhs, input.describe_position());
         return false;
     }
 
@@ -528,19 +1025,19 @@ bool Grammar::file_parse_PRODUCTION(std::ifstream& input) {
         return false;
     }
 
-    spdlog::trace("Found production `{} ::= {}`", new_lhs, new_rhs->to_string());
+    COMP3931_TRACE("Found production `{} ::= {}`", new_lhs, new_rhs->to_string());
 
-    return add_production(new_lhs, new_rhs);
+    return add_production(std::string(new_lhs), new_rhs);
 }
 
-bool Grammar::file_parse_LHS(std::ifstream& input, std::string& new_lhs) {
-    spdlog::trace("Parsing LHS");
+bool Grammar::file_parse_LHS(InputBuffer& input, std::string_view& new_lhs) {
+    COMP3931_TRACE("Parsing LHS");
 
     return file_parse_TERMINAL(input, new_lhs);
 }
 
-bool Grammar::file_parse_RHS(std::ifstream& input, EBNFToken* new_rhs) {
-    spdlog::trace("Parsing RHS");
+bool Grammar::file_parse_RHS(InputBuffer& input, EBNFToken* new_rhs) {
+    COMP3931_TRACE("Parsing RHS");
 
     if (!file_parse_skip_white_space(input)) {
         return false;
@@ -593,8 +1090,8 @@ bool Grammar::file_parse_RHS(std::ifstream& input, EBNFToken* new_rhs) {
     return true;
 }
 
-bool Grammar::file_parse_TERM(std::ifstream& input, EBNFToken* new_rhs) {
-    spdlog::trace("Parsing TERM");
+bool Grammar::file_parse_TERM(InputBuffer& input, EBNFToken* new_rhs) {
+    COMP3931_TRACE("Parsing TERM");
 
     if (!file_parse_skip_white_space(input)) {
         return false;
@@ -633,8 +1130,8 @@ bool Grammar::file_parse_TERM(std::ifstream& input, EBNFToken* new_rhs) {
     return true;
 }
 
-bool Grammar::file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs) {
-    spdlog::trace("Parsing FACTOR");
+bool Grammar::file_parse_FACTOR(InputBuffer& input, EBNFToken* new_rhs) {
+    COMP3931_TRACE("Parsing FACTOR");
 
     EBNFToken* new_token = nullptr;
 
@@ -647,7 +1144,7 @@ bool Grammar::file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs) {
     if (i == EOF) {
         return true;
     } else if (i == '[') {
-        spdlog::trace("FACTOR - OPTIONAL");
+        COMP3931_TRACE("FACTOR - OPTIONAL");
 
         if (!file_parse_check_char(input, '[')) {
             return false;
@@ -676,7 +1173,7 @@ bool Grammar::file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs) {
 
         new_rhs->add_child(new_token);
     } else if (i == '{') {
-        spdlog::trace("FACTOR - REPEAT");
+        COMP3931_TRACE("FACTOR - REPEAT");
 
         if (!file_parse_check_char(input, '{')) {
             return false;
@@ -705,7 +1202,7 @@ bool Grammar::file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs) {
 
         new_rhs->add_child(new_token);
     } else if (i == '(') {
-        spdlog::trace("FACTOR - GROUP");
+        COMP3931_TRACE("FACTOR - GROUP");
 
         if (!file_parse_check_char(input, '(')) {
             return false;
@@ -734,7 +1231,7 @@ bool Grammar::file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs) {
 
         new_rhs->add_child(new_token);
     } else {
-        std::string new_token_value = "";
+        std::string_view new_token_value;
 
         if (!file_parse_TERMINAL(input, new_token_value)) {
             return false;
@@ -744,13 +1241,16 @@ bool Grammar::file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs) {
             return false;
         }
 
-        spdlog::trace("FACTOR TERMINAL: {}", new_token_value);
+        COMP3931_TRACE("FACTOR TERMINAL: {}", new_token_value);
+
+        int terminal_id = symbol_table.get_terminal_id(new_token_value);
+        int nonterminal_id = symbol_table.get_nonterminal_id(new_token_value);
 
-        if (is_terminal(new_token_value)) {
-            new_token = new EBNFToken(EBNFToken::TokenType::TERMINAL, new_token_value);
+        if (terminal_id != -1 && terminal_id != SymbolTable::EOF_ID) {
+            new_token = new EBNFToken(EBNFToken::TokenType::TERMINAL, std::string(new_token_value), terminal_id);
             new_rhs->add_child(new_token);
-        } else if (is_nonterminal(new_token_value)) {
-            new_token = new EBNFToken(EBNFToken::TokenType::NONTERMINAL, new_token_value);
+        } else if (nonterminal_id != -1) {
+            new_token = new EBNFToken(EBNFToken::TokenType::NONTERMINAL, std::string(new_token_value), nonterminal_id);
             new_rhs->add_child(new_token);
         } else {
             spdlog::error("Value '{}' used in production is neither a terminal or nonterminal", new_token_value);
@@ -761,7 +1261,7 @@ bool Grammar::file_parse_FACTOR(std::ifstream& input, EBNFToken* new_rhs) {
     return true;
 }
 
-bool Grammar::file_parse_skip_white_space(std::ifstream& input) {
+bool Grammar::file_parse_skip_white_space(InputBuffer& input) {
     int i = input.peek();
     char c;
 
@@ -773,7 +1273,7 @@ bool Grammar::file_parse_skip_white_space(std::ifstream& input) {
     return true;
 }
 
-bool Grammar::file_parse_end_of_line(std::ifstream& input) {
+bool Grammar::file_parse_end_of_line(InputBuffer& input) {
     if (!file_parse_skip_white_space(input)) {
         return false;
     }
@@ -784,248 +1284,347 @@ bool Grammar::file_parse_end_of_line(std::ifstream& input) {
     if (i == '\r') {
         // Windows line ending =(
         if (!input.get(c)) {
-            spdlog::error("Error reading file at position {}", input.tellg());
+            spdlog::error("Error reading file at {}", input.describe_position());
             return false;
         }
 
         if (c != '\r') {
-            spdlog::error("Expected return character but found `{}` at position {}", c, input.tellg());
+            spdlog::error("Expected return character but found `{}` at {}", c, input.describe_position());
             return false;
         }
     }
 
     if (!input.get(c)) {
-        spdlog::error("Error reading file at position {}", input.tellg());
+        spdlog::error("Error reading file at {}", input.describe_position());
         return false;
     }
 
     if (c != '\n') {
-        spdlog::error("Expected newline character but found `{}` at position {}", c, input.tellg());
+        spdlog::error("Expected newline character but found `{}` at {}", c, input.describe_position());
         return false;
     }
 
     return true;
 }
 
-bool Grammar::file_parse_check_char(std::ifstream& input, char character) {
+bool Grammar::file_parse_check_char(InputBuffer& input, char character) {
     char c;
 
     if (!input.get(c)) {
-        spdlog::error("Error reading file at position {}", input.tellg());
+        spdlog::error("Error reading file at {}", input.describe_position());
         return false;
     }
 
     if (c != character) {
-        spdlog::error("Expected `{}` but found `{}` at position {}", character, c, input.tellg());
+        spdlog::error("Expected `{}` but found `{}` at {}", character, c, input.describe_position());
         return false;
     }
 
     return true;
 }
 
-bool Grammar::calculate_all_first_sets() {
-    spdlog::trace("Calculating first set");
-    // First(terminal) = {terminal}
-    for (std::string terminal : terminals) {
-        first_sets.insert({terminal, std::set<std::string>({terminal})});
+bool Grammar::resolve_symbol_ids(EBNFToken* ebnf_token) {
+    if (ebnf_token == nullptr) {
+        spdlog::error("Internal error. EBNF parser tree invalid while resolving symbol IDs");
+        return false;
     }
 
-    // Initlaise empty sets for each of the non-terminals
-    for (std::string nonterminal : nonterminals) {
-        first_sets.insert({nonterminal, std::set<std::string>()});
+    if (ebnf_token->get_symbol_id() == -1) {
+        if (ebnf_token->get_type() == EBNFToken::TokenType::TERMINAL) {
+            ebnf_token->set_symbol_id(symbol_table.get_terminal_id(ebnf_token->get_value()));
+        } else if (ebnf_token->get_type() == EBNFToken::TokenType::NONTERMINAL) {
+            ebnf_token->set_symbol_id(symbol_table.get_nonterminal_id(ebnf_token->get_value()));
+        }
     }
 
-    // Compute the First sets
-    bool sets_have_changed = true;
+    for (EBNFToken* child : ebnf_token->get_children()) {
+        if (!resolve_symbol_ids(child)) {
+            return false;
+        }
+    }
 
-    while (sets_have_changed) {
-        sets_have_changed = false;
+    return true;
+}
 
-        for (std::pair<std::string, EBNFToken*> ebnf_production : production_rules) {
-            std::string production_lhs = ebnf_production.first;
-            EBNFToken* productions = ebnf_production.second;
+bool Grammar::calculate_all_first_sets() {
+    COMP3931_TRACE("Calculating first set");
+    // First(terminal) = {terminal} is implicit for terminal IDs, so only nonterminals need sets
 
-            if (productions == nullptr) {
-                continue;
-            }
+    // Initlaise empty sets for each of the non-terminals and each IR node
+    first_sets.assign(symbol_table.get_nonterminal_count(), SymbolSet(symbol_table.get_terminal_count()));
+    ir.reset_first_sets(symbol_table.get_terminal_count());
 
-            std::unordered_map<std::string, std::set<std::string>>::iterator old_first_set_it = first_sets.find(production_lhs);
-            if (old_first_set_it == first_sets.end()) {
-                spdlog::error("Error looking up first set for nonterminal `{}`", production_lhs);
-                return false;
-            }
-            std::set<std::string>& old_first_set = old_first_set_it->second;
+    // A production only needs recalculating when the First set of a nonterminal it refers to grows, so record which
+    // productions refer to each nonterminal
+    std::vector<std::vector<int>> referring_productions(ir.get_production_count());
+
+    for (int production_lhs = 0; production_lhs < ir.get_production_count(); production_lhs++) {
+        int production_root = ir.get_production(production_lhs);
+
+        if (production_root == -1) {
+            continue;
+        }
+
+        for (int node = production_root; node < ir.get_production_end(production_lhs); node++) {
+            int nonterminal_id = ir.get_node(node).symbol_id;
 
-            std::set<std::string> new_first_set = calculate_first_terminal(productions);
+            if (ir.get_node(node).type == EBNFToken::TokenType::NONTERMINAL && nonterminal_id < ir.get_production_count()) {
+                std::vector<int>& referrers = referring_productions[nonterminal_id];
 
-            // Check if the new first set is the same as the old one
-            for (std::string terminal : new_first_set) {
-                if (old_first_set.count(terminal) != 1) {
-                    sets_have_changed = true;
-                    old_first_set.insert(terminal);
+                if (referrers.empty() || referrers.back() != production_lhs) {
+                    referrers.push_back(production_lhs);
                 }
             }
         }
     }
 
-    return true;
-}
-
-// Calculate the terminals to appear in the first set for nonterminal using its EBNF production tree
-// NOTE: This function assumes that the EBNF production tree is valid. There is little to no error checking
-std::set<std::string> Grammar::calculate_first_terminal(EBNFToken* ebnf_token) {
-    std::set<std::string> local_first_set;
+    // Compute the First sets with a worklist, in rounds like the Follow sets
+    std::vector<int> current_round;
+    std::vector<int> next_round;
+    std::vector<bool> is_queued(ir.get_production_count(), false);
 
-    if (ebnf_token == nullptr) {
-        spdlog::error("Internal error. EBNF parser tree invalid while computing first set");
-        return local_first_set;
+    for (int production_lhs = 0; production_lhs < ir.get_production_count(); production_lhs++) {
+        if (ir.get_production(production_lhs) != -1) {
+            current_round.push_back(production_lhs);
+            is_queued[production_lhs] = true;
+        }
     }
 
-    spdlog::trace("Calculating terminals from `{}` for first set", ebnf_token->to_string());
+    while (!current_round.empty()) {
+        for (int production_lhs : current_round) {
+            int production_root = ir.get_production(production_lhs);
+            is_queued[production_lhs] = false;
 
-    std::vector<EBNFToken*>& ebnf_token_children = ebnf_token->get_children();
-
-    switch (ebnf_token->get_type()) {
-        case EBNFToken::TokenType::SEQUENCE: {
-            std::set<std::string> tmp_set = calculate_first_terminal(ebnf_token_children[0]);
-            local_first_set.insert(tmp_set.begin(), tmp_set.end());
+            // Children always come after their parent in the IR, so scanning backwards calculates each node after its children
+            for (int node = ir.get_production_end(production_lhs) - 1; node >= production_root; node--) {
+                calculate_first_terminal(node);
+            }
 
-            if (tmp_set.count("epsilon") == 1) {
-                // We copied the entire tmp_set to local_first_set but shouldn't have copied epsilon, if it existed
-                local_first_set.erase("epsilon");
+            // Check if the new first set adds anything to the old one
+            if (first_sets[production_lhs].unite(ir.get_first_set(production_root))) {
+                for (int referrer : referring_productions[production_lhs]) {
+                    if (!is_queued[referrer]) {
+                        next_round.push_back(referrer);
+                        is_queued[referrer] = true;
+                    }
+                }
             }
+        }
 
-            bool contains_epsilon = tmp_set.count("epsilon") == 1;
-            int i = 0;
+        current_round.swap(next_round);
+        next_round.clear();
+    }
 
-            while (contains_epsilon && (i < ebnf_token_children.size() - 1)) {
-                tmp_set = calculate_first_terminal(ebnf_token_children[i + 1]);
-                local_first_set.insert(tmp_set.begin(), tmp_set.end());
+    // Nothing is queued, so the First set of every IR node is final as well
 
-                if (tmp_set.count("epsilon") == 1) {
-                    // We copied the entire tmp_set to local_first_set but shouldn't have copied epsilon, if it existed
-                    local_first_set.erase("epsilon");
-                }
+    return true;
+}
 
-                i++;
-                contains_epsilon = tmp_set.count("epsilon") == 1;
+// Add the terminals from the first sets of the children of an IR node to the node's own first set
+// First sets only ever grow while the fixpoint runs, so the set from the previous pass is extended rather than rebuilt
+// NOTE: This function assumes that the IR is valid. There is little to no error checking
+void Grammar::calculate_first_terminal(int node_index) {
+    const GrammarIR::Node& node = ir.get_node(node_index);
+    SymbolSet& local_first_set = ir.get_first_set(node_index);
+
+    first_set_calculations++;
+
+    switch (node.type) {
+        case EBNFToken::TokenType::SEQUENCE: {
+            // Add the first sets of the children up to and including the first one that cannot become epsilon
+            bool contains_epsilon = true;
+
+            for (int i = 0; i < node.child_count && contains_epsilon; i++) {
+                const SymbolSet& child_first_set = ir.get_first_set(node.first_child + i);
+                local_first_set.unite(child_first_set);
+                contains_epsilon = child_first_set.contains(SymbolTable::EPSILON_ID);
             }
 
-            tmp_set = calculate_first_terminal(ebnf_token_children[ebnf_token_children.size() - 1]);
-            if (i == ebnf_token_children.size() - 1 && tmp_set.count("epsilon") == 1) {
-                local_first_set.insert("epsilon");
+            // Epsilon was copied from the nullable children but is only in the set if every child is nullable. Children
+            // never stop being nullable, so this never removes epsilon that a previous pass added
+            if (contains_epsilon) {
+                local_first_set.insert(SymbolTable::EPSILON_ID);
+            } else {
+                local_first_set.erase(SymbolTable::EPSILON_ID);
             }
         }
         break;
         case EBNFToken::TokenType::TERMINAL:
-            local_first_set.insert(ebnf_token->get_value());
+            local_first_set.insert(node.symbol_id);
             break;
-        case EBNFToken::TokenType::NONTERMINAL: {
+        case EBNFToken::TokenType::NONTERMINAL:
             // Join the sets of local_first_set and first(NONTERMINAL)
-            std::unordered_map<std::string, std::set<std::string>>::iterator current_token_first_set_it = first_sets.find(ebnf_token->get_value());
-
-            if (current_token_first_set_it == first_sets.end()) {
-                spdlog::error("Error calculating first sets. Couldn't find first set for `{}`", ebnf_token->get_value());
-                return local_first_set;
-            }
-
-            local_first_set.insert(current_token_first_set_it->second.begin(), current_token_first_set_it->second.end());
-        }
-        break;
+            local_first_set.unite(first_sets[node.symbol_id]);
+            break;
         case EBNFToken::TokenType::OR:
-            for (EBNFToken* new_ebnf_token : ebnf_token_children) {
-                std::set<std::string> tmp_set = calculate_first_terminal(new_ebnf_token);
-                local_first_set.insert(tmp_set.begin(), tmp_set.end());
+            for (int i = 0; i < node.child_count; i++) {
+                local_first_set.unite(ir.get_first_set(node.first_child + i));
             }
             break;
         case EBNFToken::TokenType::REPEAT:
         case EBNFToken::TokenType::OPTIONAL:
-            local_first_set = calculate_first_terminal(ebnf_token_children[0]);
-            local_first_set.insert("epsilon");    // Optional and Repeat may become the empty string
+            local_first_set.unite(ir.get_first_set(node.first_child));
+            local_first_set.insert(SymbolTable::EPSILON_ID);    // Optional and Repeat may become the empty string
             break;
         case EBNFToken::TokenType::GROUP:
-            local_first_set = calculate_first_terminal(ebnf_token_children[0]);
+            local_first_set.unite(ir.get_first_set(node.first_child));
             break;
         default:
             spdlog::error("Unkown type of EBNFToken when calculating terminals for first set");
     }
 
-    std::string first_set_list = "";
-
-    for (std::string terminal : local_first_set) {
-        first_set_list += terminal;
-        first_set_list += ", ";
-    }
-
-    spdlog::trace("First({}) = {}", ebnf_token->to_string(), first_set_list);
-
-    return local_first_set;
+    COMP3931_TRACE("First({}) = {}", ir.to_string(node_index, symbol_table), symbol_set_to_string(local_first_set));
 }
 
 bool Grammar::calculate_all_follow_sets() {
-    spdlog::trace("Calculating follow set");
+    COMP3931_TRACE("Calculating follow set");
 
     // Initlaise empty sets for each of the non-terminals
-    for (std::string nonterminal : nonterminals) {
-        follow_sets.insert({nonterminal, std::set<std::string>()});
-    }
+    follow_sets.assign(symbol_table.get_nonterminal_count(), SymbolSet(symbol_table.get_terminal_count()));
 
     // Follow(S) = eof
-    follow_sets.find(start_symbol)->second.insert("eof");
+    int start_symbol_id = symbol_table.get_nonterminal_id(start_symbol);
+    if (start_symbol_id == -1) {
+        spdlog::error("Cannot calculate follow sets without a start symbol");
+        return false;
+    }
+    follow_sets[start_symbol_id].insert(SymbolTable::EOF_ID);
 
-    // Compute the Follow sets
-    bool sets_have_changed = true;
+    // A production only needs to be revisited when Follow(lhs) grows and some nonterminal sits at a trailing
+    // position in it, because that is the only place Follow(lhs) is copied into another Follow set. Both vectors cover
+    // every nonterminal, as any of them can have its Follow set grow, even one with no production
+    std::vector<bool> passes_follow_on(symbol_table.get_nonterminal_count(), false);
+    int production_count = 0;
 
-    while (sets_have_changed) {
-        sets_have_changed = false;
+    for (int production_lhs = 0; production_lhs < ir.get_production_count(); production_lhs++) {
+        if (ir.get_production(production_lhs) == -1) {
+            continue;
+        }
 
-        for (std::pair<std::string, EBNFToken*> ebnf_production : production_rules) {
-            std::string production_lhs = ebnf_production.first;
-            EBNFToken* productions = ebnf_production.second;
+        bool is_trailing = true;
+        std::vector<int> trailing_nonterminals;
+        calculate_trailing_nonterminals(ir.get_production(production_lhs), is_trailing, trailing_nonterminals);
 
-            if (productions == nullptr) {
-                continue;
-            }
+        passes_follow_on[production_lhs] = !trailing_nonterminals.empty();
+        production_count++;
+    }
 
-            // Get the follow set of A
-            std::unordered_map<std::string, std::set<std::string>>::iterator lhs_follow_set_it = follow_sets.find(production_lhs);
-            if (lhs_follow_set_it == follow_sets.end()) {
-                spdlog::error("Error looking up follow set for nonterminal `{}`", production_lhs);
-                return false;
-            }
-            std::set<std::string> lhs_follow_set = lhs_follow_set_it->second;
+    // Compute the Follow sets with a worklist. Every production is visited once, after which a production
+    // is only queued again when its lhs Follow set grew. Each round is the set of productions queued by the last
+    std::vector<int> current_round;
+    std::vector<int> next_round;
+    std::vector<bool> is_queued(symbol_table.get_nonterminal_count(), false);
+    std::vector<SymbolSet> trailer;
+    std::vector<int> changed_follow_sets;
+    int round_count = 0;
+
+    for (int production_lhs = 0; production_lhs < ir.get_production_count(); production_lhs++) {
+        if (ir.get_production(production_lhs) != -1) {
+            current_round.push_back(production_lhs);
+            is_queued[production_lhs] = true;
+        }
+    }
+
+    follow_production_visits = 0;
+
+    while (!current_round.empty()) {
+        round_count++;
 
-            spdlog::trace("Updating follow sets from production `{} ::= {}`", production_lhs, productions->to_string());
+        for (int production_lhs : current_round) {
+            int productions = ir.get_production(production_lhs);
+            is_queued[production_lhs] = false;
+            follow_production_visits++;
 
-            std::vector<std::set<std::string>> trailer = {};
-            trailer.push_back(lhs_follow_set);
+            COMP3931_TRACE("Updating follow sets from production `{} ::= {}`", symbol_table.get_nonterminal_name(production_lhs), ir.to_string(productions, symbol_table));
 
-            bool did_child_change_sets = calculate_follow_terminal(production_lhs, productions, trailer);
+            // The trailer starts as the follow set of A
+            trailer.assign(1, follow_sets[production_lhs]);
+            changed_follow_sets.clear();
 
-            if (did_child_change_sets == true) {
-                sets_have_changed = true;
+            calculate_follow_terminal(productions, trailer, changed_follow_sets);
+
+            for (int changed_nonterminal : changed_follow_sets) {
+                if (passes_follow_on[changed_nonterminal] && !is_queued[changed_nonterminal]) {
+                    next_round.push_back(changed_nonterminal);
+                    is_queued[changed_nonterminal] = true;
+                }
             }
         }
+
+        current_round.swap(next_round);
+        next_round.clear();
     }
 
+    // Rescanning the whole grammar would have taken a pass per round plus a final pass to see nothing changed
+    follow_visits_saved = (round_count + 1) * production_count - follow_production_visits;
+
+    COMP3931_DEBUG("Follow sets converged after {} production visits in {} rounds, saving {} visits over rescanning every production", follow_production_visits, round_count, follow_visits_saved);
+
     return true;
 }
 
-// Update the Follow sets from a production (or part of a production)
-bool Grammar::calculate_follow_terminal(std::string production_lhs, EBNFToken* ebnf_token, std::vector<std::set<std::string>>& current_trailers) {
-    if (ebnf_token == nullptr) {
-        spdlog::error("Internal error. EBNF parser tree invalid while computing follow set");
-        return false;
+// Find the nonterminals in a production (or part of a production) that the Follow set of the production's lhs is
+// added to. is_trailing is true when the trailer after the node still contains Follow(lhs), and is updated to
+// whether the trailer before the node does. This mirrors how calculate_follow_terminal moves the trailers
+void Grammar::calculate_trailing_nonterminals(int node_index, bool& is_trailing, std::vector<int>& trailing_nonterminals) {
+    const GrammarIR::Node& node = ir.get_node(node_index);
+
+    switch (node.type) {
+        case EBNFToken::TokenType::SEQUENCE:
+            for (int i = node.child_count - 1; i >= 0; i--) {
+                calculate_trailing_nonterminals(node.first_child + i, is_trailing, trailing_nonterminals);
+            }
+            break;
+        case EBNFToken::TokenType::TERMINAL:
+            is_trailing = false;
+            break;
+        case EBNFToken::TokenType::NONTERMINAL:
+            if (is_trailing) {
+                trailing_nonterminals.push_back(node.symbol_id);
+            }
+
+            if (!ir.is_nullable(node_index)) {
+                is_trailing = false;
+            }
+            break;
+        case EBNFToken::TokenType::OR:
+        case EBNFToken::TokenType::REPEAT:
+        case EBNFToken::TokenType::OPTIONAL: {
+            bool original_is_trailing = is_trailing;
+
+            for (int i = node.child_count - 1; i >= 0; i--) {
+                bool child_is_trailing = original_is_trailing;
+                calculate_trailing_nonterminals(node.first_child + i, child_is_trailing, trailing_nonterminals);
+                is_trailing = is_trailing || child_is_trailing;
+            }
+        }
+            break;
+        case EBNFToken::TokenType::GROUP:
+            if (!ir.is_nullable(node_index)) {
+                is_trailing = false;
+            }
+
+            for (int i = node.child_count - 1; i >= 0; i--) {
+                bool child_is_trailing = is_trailing;
+                calculate_trailing_nonterminals(node.first_child + i, child_is_trailing, trailing_nonterminals);
+                is_trailing = is_trailing || child_is_trailing;
+            }
+            break;
+        default:
+            spdlog::error("Unkown type of EBNFToken when calculating trailing nonterminals");
     }
+}
 
-    std::vector<EBNFToken*>& ebnf_token_children = ebnf_token->get_children();
+// Update the Follow sets from a production (or part of a production)
+bool Grammar::calculate_follow_terminal(int node_index, std::vector<SymbolSet>& current_trailers, std::vector<int>& changed_follow_sets) {
+    const GrammarIR::Node& node = ir.get_node(node_index);
     bool has_changed_sets = false;
 
-    switch (ebnf_token->get_type()) {
+    switch (node.type) {
         case EBNFToken::TokenType::SEQUENCE:
         {
-            for (int i = ebnf_token_children.size() - 1; i >= 0; i--) {
-                bool did_child_change_sets = calculate_follow_terminal(production_lhs, ebnf_token_children[i], current_trailers);
+            for (int i = node.child_count - 1; i >= 0; i--) {
+                bool did_child_change_sets = calculate_follow_terminal(node.first_child + i, current_trailers, changed_follow_sets);
 
                 if (did_child_change_sets == true) {
                     has_changed_sets = true;
@@ -1035,55 +1634,42 @@ bool Grammar::calculate_follow_terminal(std::string production_lhs, EBNFToken* e
             break;
         case EBNFToken::TokenType::TERMINAL:
         {
-            // Get the first set of ebnf_token
-            std::unordered_map<std::string, std::set<std::string>>::iterator terminal_first_set_it = first_sets.find(ebnf_token->get_value());
-            if (terminal_first_set_it == first_sets.end()) {
-                spdlog::error("Error looking up first set for terminal `{}`", ebnf_token->to_string());
-                return false;
-            }
+            // Remove all other trailers and set trailer to the first set of the terminal, which is just the terminal
+            SymbolSet terminal_first_set(symbol_table.get_terminal_count());
+            terminal_first_set.insert(node.symbol_id);
 
-            // Remove all other trailers and set trailer to the first set of the terminal
             current_trailers.clear();
-            current_trailers.push_back(terminal_first_set_it->second);
+            current_trailers.push_back(terminal_first_set);
         }
             break;
         case EBNFToken::TokenType::NONTERMINAL:
         {
-            // Get the follow set of NONTERMINAL
-            std::unordered_map<std::string, std::set<std::string>>::iterator nonterminal_follow_set_it = follow_sets.find(ebnf_token->get_value());
-            if (nonterminal_follow_set_it == follow_sets.end()) {
-                spdlog::error("Error looking up follow set for nonterminal `{}`", ebnf_token->to_string());
-                return false;
-            }
-            std::set<std::string>& nonterminal_follow_set = nonterminal_follow_set_it->second;
+            int nonterminal_id = node.symbol_id;
+            SymbolSet& nonterminal_follow_set = follow_sets[nonterminal_id];
 
             // Add the current trailer set to the nonterminal follow set
-            // NOTE: We do this item by item manually so we can tell if the Follow set was updated (i.e. a new element was added)
-            for (std::set<std::string> current_trailer : current_trailers) {
-                for (std::string s : current_trailer) {
-                    spdlog::trace("Adding `{}` to Follow({})", s, ebnf_token->to_string());
-                    std::pair<std::set<std::string>::iterator, bool> insert_status = nonterminal_follow_set.insert(s);
-
-                    if (insert_status.second == true) {
-                        // A new item was inserted, hence the set changed
-                        has_changed_sets = true;
-                    }
+            bool did_follow_set_change = false;
+
+            for (const SymbolSet& current_trailer : current_trailers) {
+                if (nonterminal_follow_set.unite(current_trailer)) {
+                    // A new item was inserted, hence the set changed
+                    did_follow_set_change = true;
                 }
             }
 
-            // Get the first set of NONTERMINAL
-            std::unordered_map<std::string, std::set<std::string>>::iterator nonterminal_first_set_it = first_sets.find(ebnf_token->get_value());
-            if (nonterminal_first_set_it == first_sets.end()) {
-                spdlog::error("Error looking up first set for nonterminal `{}`", ebnf_token->to_string());
-                return false;
+            if (did_follow_set_change) {
+                has_changed_sets = true;
+                changed_follow_sets.push_back(nonterminal_id);
+                COMP3931_TRACE("Follow({}) is now {}", symbol_table.get_nonterminal_name(nonterminal_id), symbol_set_to_string(nonterminal_follow_set));
             }
-            std::set<std::string>& nonterminal_first_set = nonterminal_first_set_it->second;
 
-            if (nonterminal_first_set.count("epsilon") == 1) {
+            const SymbolSet& nonterminal_first_set = first_sets[nonterminal_id];
+
+            if (nonterminal_first_set.contains(SymbolTable::EPSILON_ID)) {
                 // Add the first set of the nonterminal (minus epsilon) to each trailer
-                for (std::set<std::string>& current_trailer : current_trailers) {
-                    current_trailer.insert(nonterminal_first_set.begin(), nonterminal_first_set.end());
-                    current_trailer.erase("epsilon");       // epsilon shouldn't have been copied
+                for (SymbolSet& current_trailer : current_trailers) {
+                    current_trailer.unite(nonterminal_first_set);
+                    current_trailer.erase(SymbolTable::EPSILON_ID);       // epsilon shouldn't have been copied
                 }
             } else {
                 // Remove all other trailers and set trailer to the first set of the nonterminal
@@ -1093,44 +1679,21 @@ bool Grammar::calculate_follow_terminal(std::string production_lhs, EBNFToken* e
         }
             break;
         case EBNFToken::TokenType::OR:
-        {
-            std::vector<std::set<std::string>> original_trailers = current_trailers;
-
-            for (int i = ebnf_token_children.size() - 1; i >= 0; i--) {
-                std::vector<std::set<std::string>> new_trailers = original_trailers;
-                bool did_child_change_sets = calculate_follow_terminal(production_lhs, ebnf_token_children[i], new_trailers);
-
-                if (did_child_change_sets == true) {
-                    has_changed_sets = true;
-                }
-
-                current_trailers.insert(current_trailers.end(), new_trailers.begin(), new_trailers.end());
-            }
-        }
-            break;
         case EBNFToken::TokenType::REPEAT:
+        case EBNFToken::TokenType::OPTIONAL:
         {
-            std::vector<std::set<std::string>> original_trailers = current_trailers;
-
-            for (int i = ebnf_token_children.size() - 1; i >= 0; i--) {
-                std::vector<std::set<std::string>> new_trailers = original_trailers;
-                bool did_child_change_sets = calculate_follow_terminal(production_lhs, ebnf_token_children[i], new_trailers);
+            std::vector<SymbolSet> original_trailers = current_trailers;
 
-                if (did_child_change_sets == true) {
-                    has_changed_sets = true;
-                }
-
-                current_trailers.insert(current_trailers.end(), new_trailers.begin(), new_trailers.end());
+            if (node.type == EBNFToken::TokenType::REPEAT) {
+                // The body of a repeat can be followed by another repetition of itself
+                SymbolSet repeat_first_set = ir.get_first_set(node_index);
+                repeat_first_set.erase(SymbolTable::EPSILON_ID);
+                original_trailers.push_back(repeat_first_set);
             }
-        }
-            break;
-        case EBNFToken::TokenType::OPTIONAL:
-        {
-            std::vector<std::set<std::string>> original_trailers = current_trailers;
 
-            for (int i = ebnf_token_children.size() - 1; i >= 0; i--) {
-                std::vector<std::set<std::string>> new_trailers = original_trailers;
-                bool did_child_change_sets = calculate_follow_terminal(production_lhs, ebnf_token_children[i], new_trailers);
+            for (int i = node.child_count - 1; i >= 0; i--) {
+                std::vector<SymbolSet> new_trailers = original_trailers;
+                bool did_child_change_sets = calculate_follow_terminal(node.first_child + i, new_trailers, changed_follow_sets);
 
                 if (did_child_change_sets == true) {
                     has_changed_sets = true;
@@ -1142,18 +1705,15 @@ bool Grammar::calculate_follow_terminal(std::string production_lhs, EBNFToken* e
             break;
         case EBNFToken::TokenType::GROUP:
         {
-            std::vector<std::set<std::string>> original_trailers = current_trailers;
-
             // Check if group can become epsilon
-            std::set<std::string> tmp_first_set = calculate_first_terminal(ebnf_token);
-            if (tmp_first_set.count("epsilon") == 0) {
+            if (!ir.is_nullable(node_index)) {
                 // The group cannot become epsilon. Hence, the trailer after the group is finished should not contain the trailers from before the group
                 current_trailers.clear();
             }
 
-            for (int i = ebnf_token_children.size() - 1; i >= 0; i--) {
-                std::vector<std::set<std::string>> new_trailers = current_trailers;
-                bool did_child_change_sets = calculate_follow_terminal(production_lhs, ebnf_token_children[i], new_trailers);
+            for (int i = node.child_count - 1; i >= 0; i--) {
+                std::vector<SymbolSet> new_trailers = current_trailers;
+                bool did_child_change_sets = calculate_follow_terminal(node.first_child + i, new_trailers, changed_follow_sets);
 
                 if (did_child_change_sets == true) {
                     has_changed_sets = true;
@@ -0,0 +1,153 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "COMP3931GrammarIR.hpp"
+#include "spdlog/spdlog.h"
+
+using namespace ParserGenerator;
+
+/*
+ * GrammarIR Class
+ */
+
+GrammarIR::GrammarIR() {
+
+}
+
+void GrammarIR::clear() {
+    nodes.clear();
+    first_sets.clear();
+    production_roots.clear();
+    production_ends.clear();
+}
+
+int GrammarIR::add_production(int nonterminal_id, EBNFToken* production) {
+    if (nonterminal_id >= static_cast<int>(production_roots.size())) {
+        production_roots.resize(nonterminal_id + 1, -1);
+        production_ends.resize(nonterminal_id + 1, -1);
+    }
+
+    int root = nodes.size();
+    nodes.push_back({production->get_type(), production->get_symbol_id(), 0, 0});
+    production->set_ir_index(root);
+    add_children(root, production);
+
+    production_roots[nonterminal_id] = root;
+    production_ends[nonterminal_id] = nodes.size();
+
+    return root;
+}
+
+int GrammarIR::get_production(int nonterminal_id) const {
+    if (nonterminal_id < 0 || nonterminal_id >= static_cast<int>(production_roots.size())) {
+        return -1;
+    }
+
+    return production_roots[nonterminal_id];
+}
+
+int GrammarIR::get_production_end(int nonterminal_id) const {
+    if (nonterminal_id < 0 || nonterminal_id >= static_cast<int>(production_ends.size())) {
+        return -1;
+    }
+
+    return production_ends[nonterminal_id];
+}
+
+int GrammarIR::get_production_count() const { return production_roots.size(); }
+
+void GrammarIR::assign(std::vector<Node> new_nodes, std::vector<SymbolSet> new_first_sets, std::vector<int> new_production_roots, std::vector<int> new_production_ends) {
+    nodes = std::move(new_nodes);
+    first_sets = std::move(new_first_sets);
+    production_roots = std::move(new_production_roots);
+    production_ends = std::move(new_production_ends);
+}
+
+const GrammarIR::Node& GrammarIR::get_node(int index) const { return nodes[index]; }
+
+int GrammarIR::get_node_count() const { return nodes.size(); }
+
+SymbolSet& GrammarIR::get_first_set(int index) { return first_sets[index]; }
+
+bool GrammarIR::is_nullable(int index) const {
+    return first_sets[index].contains(SymbolTable::EPSILON_ID);
+}
+
+void GrammarIR::reset_first_sets(int width) {
+    first_sets.assign(nodes.size(), SymbolSet(width));
+}
+
+std::string GrammarIR::to_string(int index, const SymbolTable& symbol_table) const {
+    const Node& node = nodes[index];
+    std::string printable_value = "";
+
+    switch (node.type) {
+        case EBNFToken::TokenType::SEQUENCE:
+            for (int i = 0; i < node.child_count; i++) {
+                printable_value += to_string(node.first_child + i, symbol_table) + " ";
+            }
+            break;
+        case EBNFToken::TokenType::TERMINAL:
+            printable_value = symbol_table.get_terminal_name(node.symbol_id);
+            break;
+        case EBNFToken::TokenType::NONTERMINAL:
+            printable_value = symbol_table.get_nonterminal_name(node.symbol_id);
+            break;
+        case EBNFToken::TokenType::OR:
+            for (int i = 0; i < node.child_count; i++) {
+                printable_value += to_string(node.first_child + i, symbol_table) + " | ";
+            }
+            break;
+        case EBNFToken::TokenType::REPEAT:
+            printable_value += "{ ";
+
+            for (int i = 0; i < node.child_count; i++) {
+                printable_value += to_string(node.first_child + i, symbol_table) + " ";
+            }
+
+            printable_value += " }";
+            break;
+        case EBNFToken::TokenType::OPTIONAL:
+            printable_value += "[ ";
+
+            for (int i = 0; i < node.child_count; i++) {
+                printable_value += to_string(node.first_child + i, symbol_table) + " ";
+            }
+
+            printable_value += " ]";
+            break;
+        case EBNFToken::TokenType::GROUP:
+            printable_value += "( ";
+
+            for (int i = 0; i < node.child_count; i++) {
+                printable_value += to_string(node.first_child + i, symbol_table) + " ";
+            }
+
+            printable_value += " )";
+            break;
+        default:
+            spdlog::error("Unkown type of IR node");
+            printable_value = "";
+    }
+
+    return printable_value;
+}
+
+// Allocate all of the children of a node next to each other, then fill in each child's own children after them
+void GrammarIR::add_children(int index, EBNFToken* ebnf_token) {
+    std::vector<EBNFToken*>& children = ebnf_token->get_children();
+    int first_child = nodes.size();
+
+    for (EBNFToken* child : children) {
+        child->set_ir_index(nodes.size());
+        nodes.push_back({child->get_type(), child->get_symbol_id(), 0, 0});
+    }
+
+    nodes[index].first_child = first_child;
+    nodes[index].child_count = children.size();
+
+    for (size_t i = 0; i < children.size(); i++) {
+        add_children(first_child + i, children[i]);
+    }
+}
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define COMP3931_HAVE_MMAP
+#endif
+
+#include "COMP3931InputBuffer.hpp"
+
+using namespace ParserGenerator;
+
+/*
+ * InputBuffer Class
+ */
+
+InputBuffer::InputBuffer() : data(nullptr), size(0), position(0), mapped_data(nullptr), mapped_size(0) {
+
+}
+
+InputBuffer::~InputBuffer() {
+    close();
+}
+
+bool InputBuffer::open_file(const std::string& file_path) {
+    close();
+
+#ifdef COMP3931_HAVE_MMAP
+    int file_descriptor = open(file_path.c_str(), O_RDONLY);
+
+    if (file_descriptor == -1) {
+        return false;
+    }
+
+    struct stat file_status;
+
+    if (fstat(file_descriptor, &file_status) == 0 && file_status.st_size > 0) {
+        void* mapping = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, file_status.st_size, MADV_SEQUENTIAL);
+            ::close(file_descriptor);
+
+            mapped_data = mapping;
+            mapped_size = file_status.st_size;
+            data = static_cast<const char*>(mapping);
+            size = mapped_size;
+            return true;
+        }
+    }
+
+    // Empty files and files that can't be mapped (e.g. pipes) are read normally below
+    ::close(file_descriptor);
+#endif
+
+    std::ifstream input_file(file_path, std::ios::in | std::ios::binary);
+
+    if (!input_file.is_open()) {
+        return false;
+    }
+
+    // Read the whole file with one read when the size is known, otherwise let the stream grow the string
+    input_file.seekg(0, std::ios::end);
+    std::streamoff file_size = input_file.tellg();
+
+    if (file_size > 0) {
+        read_data.resize(static_cast<size_t>(file_size));
+        input_file.seekg(0, std::ios::beg);
+        input_file.read(&read_data[0], file_size);
+        read_data.resize(static_cast<size_t>(input_file.gcount()));
+    } else {
+        input_file.clear();
+        input_file.seekg(0, std::ios::beg);
+        read_data.assign(std::istreambuf_iterator<char>(input_file), std::istreambuf_iterator<char>());
+    }
+
+    data = read_data.data();
+    size = read_data.size();
+    return true;
+}
+
+void InputBuffer::open_string(std::string_view contents) {
+    close();
+
+    data = contents.data();
+    size = contents.size();
+}
+
+void InputBuffer::close() {
+#ifdef COMP3931_HAVE_MMAP
+    if (mapped_data != nullptr) {
+        munmap(mapped_data, mapped_size);
+    }
+#endif
+
+    mapped_data = nullptr;
+    mapped_size = 0;
+    read_data.clear();
+    kept_strings.clear();
+    data = nullptr;
+    size = 0;
+    position = 0;
+}
+
+int InputBuffer::peek() const {
+    if (position >= size) {
+        return EOF;
+    }
+
+    return static_cast<unsigned char>(data[position]);
+}
+
+bool InputBuffer::get(char& c) {
+    if (position >= size) {
+        return false;
+    }
+
+    c = data[position];
+    position++;
+
+    return true;
+}
+
+size_t InputBuffer::get_position() const { return position; }
+
+size_t InputBuffer::get_size() const { return size; }
+
+std::string_view InputBuffer::get_contents() const { return std::string_view(data, size); }
+
+std::string_view InputBuffer::slice(size_t begin, size_t end) const {
+    return std::string_view(data + begin, end - begin);
+}
+
+std::string_view InputBuffer::keep(std::string value) {
+    kept_strings.push_back(std::move(value));
+    return kept_strings.back();
+}
+
+std::string InputBuffer::describe_position(size_t offset) const {
+    int line = 1;
+    int column = 1;
+
+    for (size_t i = 0; i < offset && i < size; i++) {
+        if (data[i] == '\n') {
+            line++;
+            column = 1;
+        } else {
+            column++;
+        }
+    }
+
+    return "line " + std::to_string(line) + ", column " + std::to_string(column);
+}
+
+std::string InputBuffer::describe_position() const {
+    return describe_position(position);
+}
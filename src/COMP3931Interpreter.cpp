@@ -0,0 +1,460 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "COMP3931Interpreter.hpp"
+#include "COMP3931Grammar.hpp"
+#include "COMP3931LexerDFA.hpp"
+#include "COMP3931ParserGenerator.hpp"
+#include "spdlog/spdlog.h"
+
+using namespace ParserGenerator;
+
+namespace {
+    // Adds what the Interpreter parses to an InterpretedTree, labelled the same as a generated parser's ParseTreeNodes
+    class TreeOutput {
+    public:
+        TreeOutput(InterpretedTree& tree, const std::vector<std::string>& labels, const std::vector<bool>& has_lexeme, int terminal_count) : tree(tree), labels(labels), has_lexeme(has_lexeme), terminal_count(terminal_count) {
+
+        }
+
+        int start() {
+            tree.clear();
+            return tree.get_root();
+        }
+
+        int enter(int parent, int nonterminal_id) {
+            return tree.add_child(parent, labels[terminal_count + nonterminal_id]);
+        }
+
+        void exit(int) {
+
+        }
+
+        void token(int parent, int terminal_id, std::string_view lexeme) {
+            int node = tree.add_child(parent, labels[terminal_id]);
+
+            // Identifiers and constants are a node labelled with the token type, with the lexeme as its child
+            if (has_lexeme[terminal_id]) {
+                tree.add_child(node, lexeme);
+            }
+        }
+
+        void epsilon(int parent) {
+            tree.add_child(parent, labels[SymbolTable::EPSILON_ID]);
+        }
+
+    private:
+        InterpretedTree& tree;
+        const std::vector<std::string>& labels;
+        const std::vector<bool>& has_lexeme;
+        int terminal_count;
+    };
+
+    // Passes what the Interpreter parses on to an event handler. There is no tree, so every node is -1
+    class EventOutput {
+    public:
+        EventOutput(InterpreterEventHandler& handler) : handler(handler) {
+
+        }
+
+        int start() {
+            return -1;
+        }
+
+        int enter(int, int nonterminal_id) {
+            handler.enter(nonterminal_id);
+            return -1;
+        }
+
+        void exit(int nonterminal_id) {
+            handler.exit(nonterminal_id);
+        }
+
+        void token(int, int terminal_id, std::string_view lexeme) {
+            handler.token(terminal_id, lexeme);
+        }
+
+        void epsilon(int) {
+            // Empty alternatives are not reported to the handler
+        }
+
+    private:
+        InterpreterEventHandler& handler;
+    };
+} // namespace
+
+/*
+ * TokenSource Class
+ */
+
+TokenSource::~TokenSource() {
+
+}
+
+/*
+ * TokenVector Class
+ */
+
+TokenVector::TokenVector(const std::vector<InterpreterToken>& tokens) : tokens(tokens), next_token(0) {
+
+}
+
+void TokenVector::rewind() { next_token = 0; }
+
+/*
+ * InterpreterEventHandler Class
+ */
+
+InterpreterEventHandler::~InterpreterEventHandler() {
+
+}
+
+/*
+ * InterpretedTree Class
+ */
+
+InterpretedTree::InterpretedTree() {
+    clear();
+}
+
+void InterpretedTree::clear() {
+    nodes.clear();
+    nodes.push_back({"", -1, -1, -1});
+}
+
+int InterpretedTree::add_child(int parent, std::string_view token) {
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back({token, -1, -1, -1});
+
+    Node& parent_node = nodes[parent];
+
+    if (parent_node.last_child == -1) {
+        parent_node.first_child = index;
+    } else {
+        nodes[parent_node.last_child].next_sibling = index;
+    }
+
+    parent_node.last_child = index;
+
+    return index;
+}
+
+const InterpretedTree::Node& InterpretedTree::get_node(int index) const { return nodes[index]; }
+
+int InterpretedTree::get_root() const { return 0; }
+
+int InterpretedTree::size() const { return static_cast<int>(nodes.size()); }
+
+bool InterpretedTree::write_gnu_plot(const std::string& file_name) const {
+    std::ofstream file(file_name);
+
+    if (!file) {
+        spdlog::error("Could not open file `{}` for writing", file_name);
+        return false;
+    }
+
+    // Breadth first, numbering the nodes from 1, each line giving a node's number, its parent's and its label
+    int node_id_counter = 1;
+    std::queue<std::pair<int, int>> node_queue;
+    node_queue.push(std::pair<int, int>(-1, get_root()));
+
+    while (!node_queue.empty()) {
+        std::pair<int, int> current_node = node_queue.front();
+
+        if (current_node.first == -1) {
+            file << node_id_counter << " NaN " << '\n';
+        } else {
+            file << node_id_counter << " " << current_node.first << " " << nodes[current_node.second].token << '\n';
+        }
+
+        for (int child = nodes[current_node.second].first_child; child != -1; child = nodes[child].next_sibling) {
+            node_queue.push(std::pair<int, int>(node_id_counter, child));
+        }
+
+        node_id_counter++;
+        node_queue.pop();
+    }
+
+    return static_cast<bool>(file);
+}
+
+/*
+ * Interpreter Class
+ */
+
+Interpreter::Interpreter(Grammar& grammar, const GeneratorOptions& options) : grammar(grammar), block_comment_end(options.block_comment_end) {
+    if (!grammar.get_is_final()) {
+        grammar.finalize_grammar();
+    }
+
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    GrammarIR& ir = grammar.get_ir();
+    std::vector<std::vector<int>> rows;
+
+    terminal_count = symbol_table.get_terminal_count();
+    start_nonterminal = symbol_table.get_nonterminal_id(grammar.get_start_symbol());
+    start_production = start_nonterminal == -1 ? -1 : ir.get_production(start_nonterminal);
+
+    has_lexer = Generator::build_lexer_dfa(grammar, options, dfa);
+
+    // The rows are stored one after another so a prediction is one lookup
+    Generator::build_predictions(grammar, decisions, rows);
+
+    for (const std::vector<int>& row : rows) {
+        predictions.insert(predictions.end(), row.begin(), row.end());
+    }
+
+    for (int node_index = 0; node_index < ir.get_node_count(); node_index++) {
+        const GrammarIR::Node& node = ir.get_node(node_index);
+
+        if (node.type == EBNFToken::TokenType::TERMINAL) {
+            expected_values.push_back(symbol_table.get_terminal_name(node.symbol_id));
+        } else if (node.type == EBNFToken::TokenType::OR && !ir.is_nullable(node_index)) {
+            expected_values.push_back(ir.to_string(node_index, symbol_table));
+        } else {
+            expected_values.push_back("");
+        }
+    }
+
+    // Identifiers and constants are labelled with their type in capitals
+    for (int id = 0; id < terminal_count; id++) {
+        std::string label = symbol_table.get_terminal_name(id);
+        bool lexeme_child = label == "numeric_constant" || label == "string_literal" || label == "identifier";
+
+        if (lexeme_child) {
+            for (char& c : label) {
+                c = std::toupper(static_cast<unsigned char>(c));
+            }
+        }
+
+        labels.push_back(label);
+        has_lexeme.push_back(lexeme_child);
+    }
+
+    for (int id = 0; id < symbol_table.get_nonterminal_count(); id++) {
+        labels.push_back(symbol_table.get_nonterminal_name(id));
+    }
+}
+
+Interpreter::~Interpreter() {
+
+}
+
+bool Interpreter::lex(std::string_view text, std::vector<InterpreterToken>& tokens) {
+    if (!has_lexer) {
+        spdlog::error("Cannot lex without a lexer automaton for the grammar");
+        return false;
+    }
+
+    int string_literal_id = grammar.get_symbol_table().get_terminal_id("string_literal");
+    size_t offset = 0;
+    int line_number = 1;
+    size_t line_start = 0;
+
+    // The same scan as DFALexer::scan_token(): the longest match wins, and whitespace and comments are skipped
+    while (offset < text.size()) {
+        size_t start = offset;
+        size_t end = start + 1;
+        int accept = LexerDFA::NO_ACCEPT;
+        int state = LexerDFA::START_STATE;
+
+        for (size_t i = start; i < text.size(); i++) {
+            state = dfa.get_transition(state, dfa.get_char_class(static_cast<unsigned char>(text[i])));
+
+            if (state == LexerDFA::DEAD_STATE) {
+                break;
+            }
+
+            if (dfa.get_accept(state) != LexerDFA::NO_ACCEPT) {
+                accept = dfa.get_accept(state);
+                end = i + 1;
+            }
+        }
+
+        offset = end;
+
+        if (accept == Generator::DFA_LINE_COMMENT) {
+            offset = std::min(text.find('\n', offset), text.size());
+        } else if (accept == Generator::DFA_BLOCK_COMMENT) {
+            size_t comment_end = text.find(block_comment_end, offset);
+            offset = comment_end == std::string_view::npos ? text.size() : comment_end + block_comment_end.size();
+        }
+
+        // Comments, strings and whitespace can all span lines, and a token is on the line it starts on
+        int token_line_number = line_number;
+        size_t token_line_start = line_start;
+
+        for (size_t i = start; i < offset; i++) {
+            if (text[i] == '\n') {
+                line_number++;
+                line_start = i + 1;
+            }
+        }
+
+        if (accept != Generator::DFA_SKIP && accept != Generator::DFA_LINE_COMMENT && accept != Generator::DFA_BLOCK_COMMENT) {
+            int kind = accept == LexerDFA::NO_ACCEPT ? terminal_count : accept;
+            std::string_view lexeme = text.substr(start, offset - start);
+
+            if (kind == string_literal_id) {
+                lexeme = lexeme.substr(1, lexeme.size() - 2);
+            }
+
+            tokens.push_back({kind, lexeme, token_line_number, static_cast<int>(start - token_line_start) + 1});
+        }
+    }
+
+    // The end of the input is at the last character of the line, or 0 after a line break
+    tokens.push_back({SymbolTable::EOF_ID, "", line_number, static_cast<int>(offset - line_start)});
+
+    return true;
+}
+
+bool Interpreter::parse(TokenSource& lexer, InterpretedTree& tree) {
+    TreeOutput output(tree, labels, has_lexeme, terminal_count);
+    return run(lexer, output);
+}
+
+bool Interpreter::parse(TokenSource& lexer, InterpreterEventHandler& handler) {
+    EventOutput output(handler);
+    return run(lexer, output);
+}
+
+const std::string& Interpreter::get_error() const { return error; }
+
+template <typename Output>
+bool Interpreter::run(TokenSource& lexer, Output& output) {
+    GrammarIR& ir = grammar.get_ir();
+    const int row_size = terminal_count + 1;
+
+    error.clear();
+    parse_stack.clear();
+
+    if (start_production == -1) {
+        error = "The grammar has no production for its start symbol";
+        return false;
+    }
+
+    // pending is the next node to parse, or -1 to carry on with the frame on top of the stack
+    const InterpreterToken* next_token = &lexer.peak_next_token();
+    int pending = start_production;
+    int new_node = output.enter(output.start(), start_nonterminal);
+
+    parse_stack.push_back({-1, 0, start_nonterminal, new_node});
+
+    while (true) {
+        if (pending == -1) {
+            if (parse_stack.empty()) {
+                break;
+            }
+
+            Frame& frame = parse_stack.back();
+            new_node = frame.tree_node;
+
+            // The nonterminal is finished
+            if (frame.nonterminal != -1) {
+                output.exit(frame.nonterminal);
+                parse_stack.pop_back();
+                continue;
+            }
+
+            const GrammarIR::Node& node = ir.get_node(frame.node);
+
+            if (node.type == EBNFToken::TokenType::REPEAT) {
+                next_token = &lexer.peak_next_token();
+                if (predictions[decisions[frame.node] * row_size + next_token->kind] != -1) {
+                    pending = node.first_child;
+                } else {
+                    parse_stack.pop_back();
+                }
+            } else {
+                pending = node.first_child + frame.next_child++;
+
+                // Nothing is left to do after the last child, so the frame can go now
+                if (frame.next_child == node.child_count) {
+                    parse_stack.pop_back();
+                }
+            }
+
+            continue;
+        }
+
+        const GrammarIR::Node& node = ir.get_node(pending);
+        int current = pending;
+        pending = -1;
+
+        switch (node.type) {
+            case EBNFToken::TokenType::SEQUENCE:
+            case EBNFToken::TokenType::GROUP:
+                // Start on the first child. A frame is only needed to come back for the rest
+                if (node.child_count > 1) {
+                    parse_stack.push_back({current, 1, -1, new_node});
+                }
+                if (node.child_count > 0) {
+                    pending = node.first_child;
+                }
+                break;
+            case EBNFToken::TokenType::REPEAT:
+                // The frame checks the next token again after each repetition
+                next_token = &lexer.peak_next_token();
+                if (predictions[decisions[current] * row_size + next_token->kind] != -1) {
+                    parse_stack.push_back({current, 0, -1, new_node});
+                    pending = node.first_child;
+                }
+                break;
+            case EBNFToken::TokenType::OPTIONAL:
+                next_token = &lexer.peak_next_token();
+                if (predictions[decisions[current] * row_size + next_token->kind] != -1) {
+                    pending = node.first_child;
+                }
+                break;
+            case EBNFToken::TokenType::OR: {
+                next_token = &lexer.peak_next_token();
+                int alternative = predictions[decisions[current] * row_size + next_token->kind];
+
+                if (alternative != -1) {
+                    pending = node.first_child + alternative;
+                } else if (ir.is_nullable(current)) {
+                    output.epsilon(new_node);
+                } else {
+                    parsing_error(*next_token, current);
+                    return false;
+                }
+            }
+            break;
+            case EBNFToken::TokenType::TERMINAL:
+                if (node.symbol_id == SymbolTable::EPSILON_ID) {
+                    output.epsilon(new_node);
+                    break;
+                }
+
+                next_token = &lexer.get_next_token();
+                if (next_token->kind != node.symbol_id) {
+                    parsing_error(*next_token, current);
+                    return false;
+                }
+
+                output.token(new_node, node.symbol_id, next_token->lexeme);
+                break;
+            case EBNFToken::TokenType::NONTERMINAL:
+                new_node = output.enter(new_node, node.symbol_id);
+                parse_stack.push_back({current, 0, node.symbol_id, new_node});
+                pending = ir.get_production(node.symbol_id);
+                break;
+            default:
+                error = "Unknown type of EBNFToken when interpreting the grammar";
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void Interpreter::parsing_error(const InterpreterToken& found_token, int node_index) {
+    error = "Line " + std::to_string(found_token.line_number) + ":" + std::to_string(found_token.char_position) + " Parsing error: expected `" + expected_values[node_index] + "` but found `" + std::string(found_token.lexeme) + "`";
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "COMP3931LexerDFA.hpp"
+
+using namespace ParserGenerator;
+
+/*
+ * LexerDFA Class
+ */
+
+const int LexerDFA::DEAD_STATE;
+const int LexerDFA::START_STATE;
+const int LexerDFA::NO_ACCEPT;
+
+LexerDFA::LexerDFA() : class_count(0) {
+
+}
+
+void LexerDFA::clear() {
+    nfa_states.clear();
+    pattern_starts.clear();
+    pattern_accepts.clear();
+    char_classes.clear();
+    class_count = 0;
+    transitions.clear();
+    accepts.clear();
+}
+
+void LexerDFA::add_literal(const std::string& text, int accept) {
+    int state = add_pattern(accept);
+
+    for (char c : text) {
+        int next_state = add_nfa_state();
+        add_edge(state, char_range(c, c), next_state);
+        state = next_state;
+    }
+
+    set_accepting(state);
+}
+
+void LexerDFA::add_identifier(int accept) {
+    CharSet start_chars = char_range('a', 'z') | char_range('A', 'Z') | char_range('_', '_');
+    CharSet chars = start_chars | char_range('0', '9');
+
+    int start = add_pattern(accept);
+    int state = add_nfa_state();
+    add_edge(start, start_chars, state);
+    add_edge(state, chars, state);
+    set_accepting(state);
+}
+
+void LexerDFA::add_number(int accept) {
+    CharSet digits = char_range('0', '9');
+
+    int start = add_pattern(accept);
+    int state = add_nfa_state();
+    add_edge(start, digits, state);
+    add_edge(state, digits, state);
+    set_accepting(state);
+}
+
+void LexerDFA::add_string(int accept) {
+    CharSet quote = char_range('"', '"');
+
+    int start = add_pattern(accept);
+    int contents = add_nfa_state();
+    int end = add_nfa_state();
+    add_edge(start, quote, contents);
+    add_edge(contents, ~quote, contents);
+    add_edge(contents, quote, end);
+    set_accepting(end);
+}
+
+void LexerDFA::add_whitespace(int accept) {
+    CharSet spaces = char_range(' ', ' ') | char_range('\t', '\r');
+
+    int start = add_pattern(accept);
+    int state = add_nfa_state();
+    add_edge(start, spaces, state);
+    add_edge(state, spaces, state);
+    set_accepting(state);
+}
+
+void LexerDFA::build() {
+    // Each state of the automaton is the set of NFA states the patterns could be in
+    std::vector<std::vector<int>> state_sets;
+    std::map<std::vector<int>, int> state_ids;
+    // Transitions by byte, before the bytes are grouped into classes
+    std::vector<int> byte_transitions;
+
+    state_sets.push_back(std::vector<int>());
+    state_ids.emplace(state_sets.back(), DEAD_STATE);
+    state_sets.push_back(pattern_starts);
+    state_ids.emplace(state_sets.back(), START_STATE);
+
+    accepts.clear();
+
+    for (size_t state = 0; state < state_sets.size(); state++) {
+        // Copied, as adding states below can move the vector
+        std::vector<int> nfa_set = state_sets[state];
+
+        // The first pattern added wins, and patterns are numbered in the order they were added
+        int pattern = -1;
+
+        for (int nfa_state : nfa_set) {
+            if (nfa_states[nfa_state].pattern != -1 && (pattern == -1 || nfa_states[nfa_state].pattern < pattern)) {
+                pattern = nfa_states[nfa_state].pattern;
+            }
+        }
+
+        accepts.push_back(pattern == -1 ? NO_ACCEPT : pattern_accepts[pattern]);
+
+        for (int c = 0; c < 256; c++) {
+            std::vector<int> next_set;
+
+            for (int nfa_state : nfa_set) {
+                for (const std::pair<CharSet, int>& edge : nfa_states[nfa_state].edges) {
+                    if (edge.first.test(c)) {
+                        next_set.push_back(edge.second);
+                    }
+                }
+            }
+
+            std::sort(next_set.begin(), next_set.end());
+            next_set.erase(std::unique(next_set.begin(), next_set.end()), next_set.end());
+
+            auto inserted = state_ids.emplace(next_set, state_sets.size());
+
+            if (inserted.second) {
+                state_sets.push_back(next_set);
+            }
+
+            byte_transitions.push_back(inserted.first->second);
+        }
+    }
+
+    // Bytes with the same column of transitions in every state can share a class
+    std::map<std::vector<int>, int> class_ids;
+    std::vector<int> class_bytes;
+
+    char_classes.assign(256, 0);
+
+    for (int c = 0; c < 256; c++) {
+        std::vector<int> column;
+
+        for (size_t state = 0; state < state_sets.size(); state++) {
+            column.push_back(byte_transitions[state * 256 + c]);
+        }
+
+        auto inserted = class_ids.emplace(column, class_bytes.size());
+
+        if (inserted.second) {
+            class_bytes.push_back(c);
+        }
+
+        char_classes[c] = inserted.first->second;
+    }
+
+    class_count = class_bytes.size();
+    transitions.clear();
+
+    for (size_t state = 0; state < state_sets.size(); state++) {
+        for (int c : class_bytes) {
+            transitions.push_back(byte_transitions[state * 256 + c]);
+        }
+    }
+}
+
+int LexerDFA::get_state_count() const { return accepts.size(); }
+
+int LexerDFA::get_class_count() const { return class_count; }
+
+int LexerDFA::get_char_class(unsigned char c) const { return char_classes[c]; }
+
+int LexerDFA::get_transition(int state, int char_class) const { return transitions[state * class_count + char_class]; }
+
+int LexerDFA::get_accept(int state) const { return accepts[state]; }
+
+int LexerDFA::add_nfa_state() {
+    nfa_states.push_back({{}, -1});
+    return nfa_states.size() - 1;
+}
+
+int LexerDFA::add_pattern(int accept) {
+    int start = add_nfa_state();
+    pattern_starts.push_back(start);
+    pattern_accepts.push_back(accept);
+    return start;
+}
+
+void LexerDFA::add_edge(int from, const CharSet& chars, int to) {
+    nfa_states[from].edges.push_back(std::make_pair(chars, to));
+}
+
+// States are only made accepting by the pattern being added
+void LexerDFA::set_accepting(int state) {
+    nfa_states[state].pattern = pattern_accepts.size() - 1;
+}
+
+LexerDFA::CharSet LexerDFA::char_range(char first, char last) {
+    CharSet chars;
+
+    for (int c = static_cast<unsigned char>(first); c <= static_cast<unsigned char>(last); c++) {
+        chars.set(c);
+    }
+
+    return chars;
+}
@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "COMP3931OutputSink.hpp"
+#include "COMP3931InputBuffer.hpp"
+#include "spdlog/spdlog.h"
+
+using namespace ParserGenerator;
+
+bool ParserGenerator::replace_file(const std::string& file_name, std::string_view contents, spdlog::level::level_enum level) {
+    std::string temporary_name = file_name + ".tmp";
+    std::ofstream file(temporary_name, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file) {
+        spdlog::log(level, "Could not open file `{}` for writing", temporary_name);
+        return false;
+    }
+
+    file.write(contents.data(), contents.size());
+    file.close();
+
+    if (!file) {
+        spdlog::log(level, "Could not write file `{}`", temporary_name);
+        remove(temporary_name.c_str());
+        return false;
+    }
+
+    // Renaming over an existing file fails on some platforms, which then lose the atomic replacement
+    if (rename(temporary_name.c_str(), file_name.c_str()) != 0) {
+        remove(file_name.c_str());
+
+        if (rename(temporary_name.c_str(), file_name.c_str()) != 0) {
+            spdlog::log(level, "Could not rename `{}` to `{}`", temporary_name, file_name);
+            remove(temporary_name.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * OutputSink Class
+ */
+
+OutputSink::~OutputSink() {
+
+}
+
+/*
+ * StringSink Class
+ */
+
+bool StringSink::write(const std::string& file_name, const std::string& contents) {
+    files[file_name] = contents;
+    return true;
+}
+
+void StringSink::discard(const std::string& file_name) {
+    files.erase(file_name);
+}
+
+const std::string& StringSink::get_contents(const std::string& file_name) const {
+    static const std::string empty_contents;
+    std::map<std::string, std::string>::const_iterator file = files.find(file_name);
+
+    return file == files.end() ? empty_contents : file->second;
+}
+
+const std::map<std::string, std::string>& StringSink::get_files() const { return files; }
+
+/*
+ * FileSink Class
+ */
+
+bool FileSink::write(const std::string& file_name, const std::string& contents) {
+    InputBuffer existing_file;
+
+    if (existing_file.open_file(file_name) && existing_file.get_contents() == contents) {
+        spdlog::info("`{}` is unchanged", file_name);
+        return true;
+    }
+
+    existing_file.close();
+    spdlog::info("Writing `{}`", file_name);
+
+    return replace_file(file_name, contents);
+}
+
+void FileSink::discard(const std::string& file_name) {
+    remove(file_name.c_str());
+}
+
+/*
+ * StreamSink Class
+ */
+
+StreamSink::StreamSink() : stream(std::cout) {
+
+}
+
+StreamSink::StreamSink(std::ostream& stream) : stream(stream) {
+
+}
+
+bool StreamSink::write(const std::string& file_name, const std::string& contents) {
+    stream << "// " << file_name << '\n' << contents;
+    stream.flush();
+
+    return static_cast<bool>(stream);
+}
+
+void StreamSink::discard(const std::string&) {
+    // Anything already written cannot be taken back
+}
@@ -1,8 +1,18 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
 #include <cstdio>
-#include <fstream>
-
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "COMP3931LexerDFA.hpp"
 #include "COMP3931ParserGenerator.hpp"
 #include "COMP3931Grammar.hpp"
+#include "COMP3931Logging.hpp"
 #include "spdlog/spdlog.h"
 
 using namespace ParserGenerator;
@@ -11,512 +21,757 @@ using namespace ParserGenerator;
  * ParserGenerator Class
  */
 
-Generator::Generator(Grammar& grammar, std::string output_file_name) : grammar(grammar), output_file_name(output_file_name) {
-    if (!grammar.get_is_final()) {
-        grammar.finalize_grammar();
+Generator::Generator(Grammar& grammar, std::string output_file_name, GeneratorOptions options, OutputSink* sink) : grammar(grammar), output_file_name(output_file_name), options(options), sink(sink != nullptr ? *sink : file_sink) {
+    if (!grammar.get_is_final() && !grammar.finalize_grammar()) {
+        return;
+    }
+
+    if (!validate(grammar, options)) {
+        return;
+    }
+
+    create_kind_names();
+    succeeded = generate();
+}
+
+Generator::~Generator() {
+
+}
+
+bool Generator::get_succeeded() { return succeeded; }
+
+bool Generator::validate(Grammar& grammar, const GeneratorOptions& options) {
+    bool valid = true;
+
+    // Reparsing splices ParseTreeNode subtrees together and moves the lexer between the parse functions
+    if (options.incremental && (options.tree_type != GeneratorOptions::POINTER_TREE || options.backend != GeneratorOptions::RECURSIVE_DESCENT || options.error_recovery)) {
+        spdlog::error("Incremental parsing needs the default parse tree and recursive descent backend, without error recovery");
+        valid = false;
+    }
+
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    GrammarIR& ir = grammar.get_ir();
+
+    for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+        if (ir.get_production(nonterminal_id) == -1) {
+            spdlog::error("No productions defined for non-terminal `{}`.", symbol_table.get_nonterminal_name(nonterminal_id));
+            valid = false;
+        }
     }
 
     // Check for First / Follow conflicts
     for (const std::string& nonterminal : grammar.get_nonterminals()) {
-        std::set<std::string> first_set = grammar.get_first_set(nonterminal);
-        std::set<std::string> follow_set = grammar.get_follow_set(nonterminal);
+        int nonterminal_id = symbol_table.get_nonterminal_id(nonterminal);
+        const SymbolSet& first_set = grammar.get_first_set(nonterminal_id);
+        const SymbolSet& follow_set = grammar.get_follow_set(nonterminal_id);
 
-        if (first_set.count("epsilon") == 1) {
+        if (first_set.contains(SymbolTable::EPSILON_ID)) {
             // Check sets are disjoint
-            for (const std::string& symbol : first_set) {
-                if (follow_set.count(symbol) != 0) {
-                    spdlog::error("First/Follow conflict detected for non-terminal `{}`. The symbol `{}` appears in both the First and Follow set while `epsilon` is also in the First set", nonterminal, symbol);
-                    return;
-                }
+            int symbol = first_set.first_common(follow_set);
+
+            if (symbol != -1) {
+                spdlog::error("First/Follow conflict detected for non-terminal `{}`. The symbol `{}` appears in both the First and Follow set while `epsilon` is also in the First set", nonterminal, symbol_table.get_terminal_name(symbol));
+                valid = false;
             }
         }
     }
 
-    generate();
-}
-
-Generator::~Generator() {
+    // Check for First / First conflicts between the alternatives of every OR
+    for (int node_index = 0; node_index < ir.get_node_count(); node_index++) {
+        if (ir.get_node(node_index).type == EBNFToken::TokenType::OR && !check_alternatives(grammar, node_index)) {
+            valid = false;
+        }
+    }
 
+    return valid;
 }
 
 bool Generator::generate() {
-    bool header_status = generate_header_file();
-    bool code_status = generate_source_file();
+    // Both files are built in memory first, so nothing is written unless both are complete
+    std::ostringstream header_file;
+    std::ostringstream code_file;
+
+    bool header_status = generate_header_file(header_file);
+    bool code_status = generate_source_file(code_file);
+
+    // Generation reads the First sets stored in the IR, so this should not have grown since finalize_grammar()
+    COMP3931_DEBUG("Calculated First sets of IR nodes {} times in total", grammar.get_first_set_calculations());
 
     if (header_status == false || code_status == false) {
-        // Something failed - delete the files as they are invalid
-        remove((output_file_name + ".hpp").c_str());
-        remove((output_file_name + ".cpp").c_str());
+        // Something failed - discard the files from any earlier run, as they no longer match the grammar
+        sink.discard(output_file_name + ".hpp");
+        sink.discard(output_file_name + ".cpp");
+        return false;
     }
 
-    return false;
+    header_status = sink.write(output_file_name + ".hpp", header_file.str());
+    code_status = sink.write(output_file_name + ".cpp", code_file.str());
+
+    return header_status && code_status;
 }
 
-bool Generator::generate_header_file() {
-    spdlog::info("Writing header file to `{}.hpp`", output_file_name);
+bool Generator::generate_header_file(std::ostream& header_file) {
+    spdlog::info("Generating header file `{}.hpp`", output_file_name);
 
-    std::ofstream header_file(output_file_name + ".hpp");
+    // Write an include guard
+    header_file << "#ifndef __" << output_file_name << "_HEADER__" << '\n';
+    header_file << "#define __" << output_file_name << "_HEADER__" << '\n';
+    header_file << '\n';
 
-    if (!header_file) {
-        spdlog::error("Could not open file `" + output_file_name + ".hpp` for writing");
-        return false;
+    // Write header file includes
+    header_file << "#include <algorithm>" << '\n';
+    header_file << "#include <atomic>" << '\n';
+    header_file << "#include <cstddef>" << '\n';
+    header_file << "#include <exception>" << '\n';
+    header_file << "#include <fstream>" << '\n';
+    header_file << "#include <memory>" << '\n';
+    header_file << "#include <stdexcept>" << '\n';
+    header_file << "#include <string>" << '\n';
+    header_file << "#include <string_view>" << '\n';
+    header_file << "#include <thread>" << '\n';
+    header_file << "#include <vector>" << '\n';
+    header_file << '\n';
+
+    // Say which kind of parse tree and which features the parser has, at file scope so code using it can check with #ifdef
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        header_file << "#define GENERATED_PARSER_FLAT_TREE" << "\n\n";
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        header_file << "#define GENERATED_PARSER_EVENTS" << "\n\n";
     }
 
-    // Write an include guard
-    header_file << "#ifndef __" << output_file_name << "_HEADER__" << std::endl;
-    header_file << "#define __" << output_file_name << "_HEADER__" << std::endl;
-    header_file << std::endl;
+    if (options.error_recovery) {
+        header_file << "#define GENERATED_PARSER_ERROR_RECOVERY" << "\n\n";
+    }
 
-    // Write header file includes
-    header_file << "#include <fstream>" << std::endl;
-    header_file << "#include <stdexcept>" << std::endl;
-    header_file << "#include <string>" << std::endl;
-    header_file << "#include <vector>" << std::endl;
-    header_file << std::endl;
+    if (options.generate_lexer) {
+        header_file << "#define GENERATED_PARSER_DFA_LEXER" << "\n\n";
+    }
+
+    if (options.incremental) {
+        header_file << "#define GENERATED_PARSER_INCREMENTAL" << "\n\n";
+    }
 
     // Start namespace
-    header_file << "namespace GeneratedParser {" << std::endl;
+    header_file << "namespace GeneratedParser {" << '\n';
+
+    // Write TokenKind and NonterminalKind enums
+    generate_kind_enums(header_file);
+
+    if (needs_node_kind_labels()) {
+        header_file << "// Label of a TokenKind or NonterminalKind, the same as the label of a ParseTreeNode" << '\n';
+        header_file << "std::string_view node_kind_label(int kind);" << "\n\n";
+    }
 
     // Write LexerToken class
-    header_file << header_lexer_token_class << std::endl << std::endl;
+    header_file << header_lexer_token_class << "\n\n";
 
     // Write ViertualLexer class
-    header_file << header_virtual_lexer_class << std::endl << std::endl;
+    header_file << header_virtual_lexer_class << "\n\n";
+
+    if (options.incremental) {
+        header_file << header_token_edit_struct << "\n\n";
+    }
 
     // Write exception classes
-    header_file << header_invalid_token_exception_class << std::endl << std::endl;
-    header_file << header_internal_error_exception_class << std::endl << std::endl;
+    header_file << header_invalid_token_exception_class << "\n\n";
+    header_file << header_internal_error_exception_class << "\n\n";
+
+    // Write parse tree classes
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        header_file << header_flat_parse_tree_class << "\n\n";
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        header_file << header_parse_event_handler_class << "\n\n";
+    } else {
+        header_file << header_parse_tree_node_class << "\n\n";
+    }
 
-    // Write ParseTreeNode class
-    header_file << header_parse_tree_node_class << std::endl << std::endl;
+    if (options.error_recovery) {
+        header_file << header_parse_diagnostic_struct << "\n\n";
+    }
 
-    // Write output_file_name class
-    header_file << "class " << output_file_name << " {" << std::endl;
-    header_file << "\tpublic:" << std::endl;
-    header_file << "\t\t" << output_file_name << "(VirtualLexer& lexer);" << std::endl;
-    header_file << "\t\t~" << output_file_name << "();" << std::endl;
-    header_file << std::endl;
-    header_file << "\t\tvoid start_parsing();" << std::endl;
-    header_file << "\t\tvoid parse_tree_gnu_plot();" << std::endl;
-    header_file << std::endl;
-    header_file << "\tprivate:" << std::endl;
-    header_file << "\t\tVirtualLexer& lexer;" << std::endl;
-    header_file << "\t\tParseTreeNode* parse_tree_root;" << std::endl;
-    header_file << std::endl;
-    header_file << "\t\tvoid parsing_error(LexerToken& found_token, std::string expected_value);" << std::endl;
+    if (options.generate_lexer) {
+        header_file << header_dfa_lexer_class << "\n\n";
+    }
+
+    // Write output_file_name class. It is a template over the lexer so that calls to a concrete lexer can be inlined
+    header_file << "// Lexer is VirtualLexer or any class with the same get_next_token() and peak_next_token() functions." << '\n';
+    header_file << "// The member functions are only compiled for the lexers instantiated in " << output_file_name << ".cpp" << '\n';
+    header_file << "// Instances share no mutable state, so separate instances can parse on separate threads at the same time" << '\n';
+    header_file << "template <typename Lexer>" << '\n';
+    header_file << "class " << parser_class_name() << " {" << '\n';
+    header_file << "\tpublic:" << '\n';
+
+    if (options.tree_type == GeneratorOptions::EVENTS) {
+        header_file << "\t\t// The handler is called as each part of the input is recognised, and no tree is built" << '\n';
+        header_file << "\t\t" << parser_class_name() << "(Lexer& lexer, ParseEventHandler& handler);" << '\n';
+    } else {
+        header_file << "\t\t" << parser_class_name() << "(Lexer& lexer);" << '\n';
+    }
+
+    header_file << "\t\t~" << parser_class_name() << "();" << '\n';
+    header_file << '\n';
+    header_file << "\t\tvoid start_parsing();" << '\n';
+
+    if (options.tree_type != GeneratorOptions::EVENTS) {
+        header_file << "\t\t// Free the parse tree" << '\n';
+        header_file << "\t\tvoid reset();" << '\n';
+        header_file << "\t\tvoid parse_tree_gnu_plot(const std::string& file_name = \"parse-tree.out\");" << '\n';
+    }
+
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        header_file << "\t\tconst FlatParseTree& get_flat_tree() const;" << '\n';
+    } else if (options.tree_type == GeneratorOptions::POINTER_TREE) {
+        header_file << "\t\tconst ParseTreeArena& get_tree_arena() const;" << '\n';
+    }
+
+    if (options.error_recovery) {
+        header_file << "\t\t// Every syntax error found by the last parse, in the order they were found" << '\n';
+        header_file << "\t\tconst std::vector<ParseDiagnostic>& get_diagnostics() const;" << '\n';
+    }
+
+    if (options.incremental) {
+        header_file << "\t\t// Parse again after the lexer's tokens were edited, reusing the subtrees the edits did not touch. The edits are in" << '\n';
+        header_file << "\t\t// the order they were made, each numbering the tokens as they were after the ones before. The last parse must have" << '\n';
+        header_file << "\t\t// started from the first token. Returns the number of tokens parsed again" << '\n';
+        header_file << "\t\tsize_t reparse(const std::vector<TokenEdit>& edits);" << '\n';
+    }
+
+    header_file << '\n';
+    header_file << "\tprivate:" << '\n';
+    header_file << "\t\tLexer& lexer;" << '\n';
+
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        header_file << "\t\tFlatParseTree flat_tree;" << '\n';
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        header_file << "\t\tParseEventHandler& handler;" << '\n';
+    } else {
+        header_file << "\t\tParseTreeArena tree_arena;" << '\n';
+        header_file << "\t\tParseTreeNode* parse_tree_root;" << '\n';
+    }
+
+    header_file << '\n';
+
+    if (options.error_recovery) {
+        header_file << "\t\tstd::vector<ParseDiagnostic> diagnostics;" << '\n';
+        header_file << "\t\t// Set when an error is at the same token as the last one, so the token must be skipped to make progress" << '\n';
+        header_file << "\t\tbool skip_error_token = false;" << '\n';
+        header_file << '\n';
+        header_file << "\t\tvoid parsing_error(const LexerToken& found_token, const char* expected_value);" << '\n';
+        header_file << "\t\t// Skip tokens until one which can follow the nonterminal being abandoned, or the end of the input" << '\n';
+        header_file << "\t\tvoid synchronize(const uint64_t* follow_set);" << '\n';
+    } else {
+        header_file << "\t\tvoid parsing_error(const LexerToken& found_token, std::string expected_value);" << '\n';
+    }
+
+    if (options.incremental) {
+        header_file << '\n';
+        header_file << "\t\t// A nonterminal's node from the last tree which may be reused, and the token it now starts at" << '\n';
+        header_file << "\t\tstruct ReusableNode {" << '\n';
+        header_file << "\t\t\tsize_t first_token;" << '\n';
+        header_file << "\t\t\tParseTreeNode* node;" << '\n';
+        header_file << "\t\t};" << "\n\n";
+        header_file << "\t\t// In order of first_token, and only filled while reparse() parses a nonterminal again" << '\n';
+        header_file << "\t\tstd::vector<ReusableNode> reusable_nodes;" << '\n';
+        header_file << "\t\tsize_t next_reusable = 0;" << '\n';
+        header_file << "\t\tsize_t reused_token_count = 0;" << '\n';
+        header_file << "\t\t// Set once the tree is complete, so its token counts match the lexer's tokens" << '\n';
+        header_file << "\t\tbool reusable_tree = false;" << "\n\n";
+        header_file << "\t\t// Add the nodes under node, which starts at first_token, that lie outside [damage_start, damage_end)" << '\n';
+        header_file << "\t\tvoid collect_reusable_nodes(ParseTreeNode* node, size_t first_token, size_t damage_start, size_t damage_end, std::ptrdiff_t delta);" << '\n';
+        header_file << "\t\t// Add a reusable node of this kind starting at the next token instead of parsing it, and move the lexer past it" << '\n';
+        header_file << "\t\tbool reuse_subtree(int kind, ParseTreeNode* parse_tree_parent);" << '\n';
+        header_file << "\t\tvoid parse_nonterminal(int kind, ParseTreeNode* parse_tree_parent);" << '\n';
+    }
 
     // Insert parsing functions here
-    std::unordered_map<std::string, EBNFToken*>& production_rules = grammar.get_all_productions();
-    for (std::pair<std::string, EBNFToken*> production : production_rules) {
-        header_file << "\t\tvoid parse_" << production.first << "(ParseTreeNode* parse_tree_parent);" << std::endl;
+    if (options.backend == GeneratorOptions::TABLE) {
+        header_file << '\n';
+        header_file << "\t\t// A grammar node still being parsed. nonterminal is -1 unless the frame is a nonterminal" << '\n';
+        header_file << "\t\tstruct ParseFrame {" << '\n';
+        header_file << "\t\t\tint node;" << '\n';
+        header_file << "\t\t\tint next_child;" << '\n';
+        header_file << "\t\t\tint nonterminal;" << '\n';
+
+        if (options.tree_type != GeneratorOptions::EVENTS) {
+            header_file << "\t\t\t" << tree_node_type() << " tree_node;" << '\n';
+        }
+
+        header_file << "\t\t};" << "\n\n";
+        header_file << "\t\t// Kept between parses so its memory is reused" << '\n';
+        header_file << "\t\tstd::vector<ParseFrame> parse_stack;" << "\n\n";
+        header_file << "\t\tvoid run_parse_table(" << parse_function_parameters() << ");" << '\n';
+    } else {
+        SymbolTable& symbol_table = grammar.get_symbol_table();
+        for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+            header_file << "\t\tvoid parse_" << symbol_table.get_nonterminal_name(nonterminal_id) << "(" << parse_function_parameters() << ");" << '\n';
+        }
     }
-    header_file << std::endl;
+    header_file << '\n';
+
+    header_file << "};" << "\n\n";
 
-    header_file << "};" << std::endl;
+    // The VirtualLexer version keeps the original class name
+    header_file << "extern template class " << parser_class_name() << "<VirtualLexer>;" << '\n';
+    header_file << "using " << output_file_name << " = " << parser_class_name() << "<VirtualLexer>;" << "\n\n";
+
+    generate_parse_files_function(header_file);
 
     // End namespace
-    header_file << "} // namespace GeneratedParser" << std::endl;
+    header_file << "} // namespace GeneratedParser" << '\n';
 
     // End include guard
-    header_file << std::endl << "#endif" << std::endl;
+    header_file << '\n' << "#endif" << '\n';
 
     return true;
 }
 
-bool Generator::generate_source_file() {
-    spdlog::info("Writing source code file to `{}.cpp`", output_file_name);
-
-    std::ofstream code_file(output_file_name + ".cpp");
-
-    if (!code_file) {
-        spdlog::error("Could not open file `" + output_file_name + ".cpp` for writing");
-        return false;
-    }
+bool Generator::generate_source_file(std::ostream& code_file) {
+    spdlog::info("Generating source code file `{}.cpp`", output_file_name);
 
     bool status = false;
 
     // Write source code file includes
-    code_file << "#include <fstream>" << std::endl;
-    code_file << "#include <queue>" << std::endl;
-    code_file << "#include <stdexcept>" << std::endl;
-    code_file << "#include <string>" << std::endl;
-    code_file << "#include <vector>" << std::endl;
-    code_file << "#include \"" << output_file_name << ".hpp\"" << std::endl;
-    code_file << std::endl;
+    code_file << "#include <algorithm>" << '\n';
+    code_file << "#include <cstdint>" << '\n';
+    code_file << "#include <fstream>" << '\n';
+    code_file << "#include <iterator>" << '\n';
+    code_file << "#include <new>" << '\n';
+    code_file << "#include <queue>" << '\n';
+    code_file << "#include <stdexcept>" << '\n';
+    code_file << "#include <string>" << '\n';
+    code_file << "#include <vector>" << '\n';
+    code_file << "#include \"" << output_file_name << ".hpp\"" << '\n';
+
+    for (const std::string& lexer_header : options.lexer_headers) {
+        code_file << "#include \"" << lexer_header << "\"" << '\n';
+    }
+
+    code_file << '\n';
 
     // Add namespace using directive
-    code_file << "using namespace GeneratedParser;" << std::endl << std::endl;
+    code_file << "using namespace GeneratedParser;" << "\n\n";
+
+    // Write token kind functions and the lookahead sets used by the parsing functions
+    generate_classify_token_function(code_file);
+    code_file << source_token_set_function << "\n\n";
+
+    if (options.backend == GeneratorOptions::TABLE) {
+        status = generate_parse_tables(code_file);
+    } else {
+        generate_lookahead_sets(code_file);
+    }
+
+    if (options.error_recovery) {
+        generate_follow_sets(code_file);
+        code_file << source_parse_diagnostic_struct << "\n\n";
+    }
 
     // Write LexerToken class
-    code_file << source_lexer_token_class << std::endl << std::endl;
+    code_file << source_lexer_token_class << "\n\n";
 
     // Write exception classes
-    code_file << source_invalid_token_exception_class << std::endl << std::endl;
-    code_file << source_internal_error_exception_class << std::endl << std::endl;
+    code_file << source_invalid_token_exception_class << "\n\n";
+    code_file << source_internal_error_exception_class << "\n\n";
 
-    // Write ParseTreeNode class
-    code_file << source_parse_tree_node_class << std::endl << std::endl;
+    // Write the generated lexer
+    if (options.generate_lexer) {
+        if (!generate_lexer_tables(code_file)) {
+            return false;
+        }
+
+        code_file << source_dfa_lexer_class << "\n\n";
+    }
+
+    // Write parse tree classes
+    if (needs_node_kind_labels()) {
+        generate_node_kind_label_function(code_file);
+    }
+
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << source_flat_parse_tree_class << "\n\n";
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        code_file << source_parse_event_handler_class << "\n\n";
+    } else {
+        code_file << source_parse_tree_node_class << "\n\n";
+    }
 
     // Write output_file_name class
-    code_file << output_file_name << "::" << output_file_name << "(VirtualLexer& lexer) : lexer(lexer), parse_tree_root(nullptr) {}" << std::endl;
-    code_file << output_file_name << "::~" << output_file_name << "() {}" << std::endl << std::endl;
+    code_file << "template <typename Lexer>" << '\n';
+
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << parser_class_name() << "<Lexer>::" << parser_class_name() << "(Lexer& lexer) : lexer(lexer) {}" << "\n\n";
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        code_file << parser_class_name() << "<Lexer>::" << parser_class_name() << "(Lexer& lexer, ParseEventHandler& handler) : lexer(lexer), handler(handler) {}" << "\n\n";
+    } else {
+        code_file << parser_class_name() << "<Lexer>::" << parser_class_name() << "(Lexer& lexer) : lexer(lexer), parse_tree_root(nullptr) {}" << "\n\n";
+    }
+
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << parser_class_name() << "<Lexer>::~" << parser_class_name() << "() {}" << "\n\n";
 
     // Write start parsing function
-    code_file << "void " << output_file_name << "::start_parsing() {" << std::endl;
-    code_file << "\tparse_tree_root = new ParseTreeNode(\"\");" << std::endl;
-    code_file << "\tparse_" << grammar.get_start_symbol() << "(parse_tree_root);" << std::endl;
-    code_file << "}" << std::endl << std::endl;
-
-    // Write parsing error function
-    code_file << "void " << output_file_name << "::" << source_parser_error_function << std::endl;
-    code_file << std::endl;
-
-    std::unordered_map<std::string, EBNFToken*>& production_rules = grammar.get_all_productions();
-    for (std::pair<std::string, EBNFToken*> production : production_rules) {
-        code_file << "// " << production.first << " ::= " << production.second->to_string() << std::endl;
-        code_file << "void " << output_file_name << "::parse_" << production.first << "(ParseTreeNode* parse_tree_parent) {" << std::endl;
-        code_file << "\t// Use peak_next_token() to define next_token reference" << std::endl;
-        code_file << "\tLexerToken& next_token = lexer.peak_next_token();" << std::endl;
-        code_file << std::endl;
+    std::string start_function = options.backend == GeneratorOptions::TABLE ? "run_parse_table" : "parse_" + grammar.get_start_symbol();
 
-        // Add the code to construct the parse tree
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "void " << parser_class_name() << "<Lexer>::start_parsing() {" << '\n';
 
-        code_file << "\tParseTreeNode* new_node = new ParseTreeNode(\"" << production.first << "\");" << std::endl;
+    if (options.error_recovery) {
+        code_file << "\tdiagnostics.clear();" << '\n';
+        code_file << "\tskip_error_token = false;" << '\n';
+    }
 
-        code_file << "\tif (parse_tree_parent == nullptr) {" << std::endl;
-        code_file << "\t\tdelete new_node;" << std::endl;
-        code_file << "\t\tthrow InternalErrorException(\"Parse tree node pointer is nullptr\");" << std::endl;
-        code_file << "\t} else {" << std::endl;
-        code_file << "\t\tparse_tree_parent->add_child(new_node);" << std::endl;
-        code_file << "\t}" << std::endl;
-        code_file << std::endl;
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << "\treset();" << '\n';
+        code_file << "\tint root = flat_tree.add_node(NT_ROOT, -1, -1);" << '\n';
+        code_file << "\t" << start_function << "(root);" << '\n';
+        code_file << "\tflat_tree.close_node(root);" << '\n';
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        code_file << "\t" << start_function << "();" << '\n';
+    } else {
+        code_file << "\treset();" << '\n';
+        code_file << "\tparse_tree_root = tree_arena.create_node(\"\");" << '\n';
+        code_file << "\t" << start_function << "(parse_tree_root);" << '\n';
+
+        if (options.incremental) {
+            code_file << "\tparse_tree_root->set_span(NT_ROOT, lexer.get_token_index());" << '\n';
+            code_file << "\treusable_tree = true;" << '\n';
+        }
+    }
 
-        if (production.second == nullptr) {
-            spdlog::error("No productions defined for non-terminal `{}`.", production.first);
-            return false;
+    code_file << "}" << "\n\n";
+
+    // Write reset function
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "void " << parser_class_name() << "<Lexer>::reset() {" << '\n';
+        code_file << "\tflat_tree.clear();" << '\n';
+        code_file << "}" << "\n\n";
+    } else if (options.tree_type == GeneratorOptions::POINTER_TREE) {
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "void " << parser_class_name() << "<Lexer>::reset() {" << '\n';
+        code_file << "\ttree_arena.reset();" << '\n';
+        code_file << "\tparse_tree_root = nullptr;" << '\n';
+
+        if (options.incremental) {
+            code_file << "\treusable_tree = false;" << '\n';
+            code_file << "\treusable_nodes.clear();" << '\n';
         }
+        code_file << "}" << "\n\n";
+    }
 
-        status = generate_production_code(code_file, production.second, 1);
-        code_file << std::endl;
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "const FlatParseTree& " << parser_class_name() << "<Lexer>::get_flat_tree() const { return flat_tree; }" << "\n\n";
+    } else if (options.tree_type == GeneratorOptions::POINTER_TREE) {
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "const ParseTreeArena& " << parser_class_name() << "<Lexer>::get_tree_arena() const { return tree_arena; }" << "\n\n";
+    }
 
-        code_file << "}" << std::endl << std::endl;
+    // Write parsing error functions
+    if (options.error_recovery) {
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "const std::vector<ParseDiagnostic>& " << parser_class_name() << "<Lexer>::get_diagnostics() const { return diagnostics; }" << "\n\n";
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "void " << parser_class_name() << "<Lexer>::" << source_recovering_parser_error_function << "\n\n";
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "void " << parser_class_name() << "<Lexer>::" << source_synchronize_function << '\n';
+    } else {
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "void " << parser_class_name() << "<Lexer>::" << source_parser_error_function << '\n';
+    }
+    code_file << '\n';
 
-        if (status == false) {
-            break;
+    // Write the parsing functions, or the function which runs the parse tables
+    if (options.backend == GeneratorOptions::TABLE) {
+        if (status == true) {
+            generate_table_driver(code_file);
+        }
+    } else {
+        status = generate_parse_functions(code_file);
+
+        if (options.incremental) {
+            generate_reparse_functions(code_file);
         }
     }
-    code_file << std::endl;
+
+    code_file << '\n';
 
     if (status == true) {
         // Write debug printing of parse tree functions
-        code_file << "void " << output_file_name << "::parse_tree_gnu_plot() {" << std::endl;
-        code_file << "\tstd::ofstream file = std::ofstream(\"parse-tree.out\");" << std::endl;
-        code_file << "\tif (!file) {" << std::endl;
-        code_file << "\t\treturn;" << std::endl;
-        code_file << "\t}" << std::endl << std::endl;
-        code_file << "\tint node_id_counter = 1;" << std::endl;
-        code_file << "\tstd::queue<std::pair<int, ParseTreeNode*>> node_queue;" << std::endl;
-        code_file << "\tnode_queue.push(std::pair<int, ParseTreeNode*>(-1, parse_tree_root));" << std::endl;
-        code_file << std::endl;
-        code_file << "\twhile (!node_queue.empty()) {" << std::endl;
-        code_file << "\t\tstd::pair<int, ParseTreeNode*> current_node = node_queue.front();" << std::endl << std::endl;
-        code_file << "\t\tif (current_node.first == -1) {" << std::endl;
-        code_file << "\t\t\tfile << node_id_counter << \" NaN \" << std::endl;" << std::endl;
-        code_file << "\t\t} else {" << std::endl;
-        code_file << "\t\t\tfile << node_id_counter << \" \" << current_node.first << \" \" << current_node.second->get_token() << std::endl;" << std::endl;
-        code_file << "\t\t}" << std::endl << std::endl;
-        code_file << "\t\t for (ParseTreeNode* child : current_node.second->get_children()) {" << std::endl;
-        code_file << "\t\t\t" << "node_queue.push(std::pair<int, ParseTreeNode*>(node_id_counter, child));" << std::endl;
-        code_file << "\t\t}" << std::endl << std::endl;
-        code_file << "\t\tnode_id_counter++;" << std::endl;
-        code_file << "\t\tnode_queue.pop();" << std::endl;
-        code_file << "\t}" << std::endl;
-        code_file << "}" << std::endl << std::endl;
+        if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+            generate_flat_tree_gnu_plot_function(code_file);
+        } else if (options.tree_type == GeneratorOptions::POINTER_TREE) {
+            generate_tree_gnu_plot_function(code_file);
+        }
+
+        // Compile the parser for VirtualLexer and for every concrete lexer it is generated for
+        code_file << "template class GeneratedParser::" << parser_class_name() << "<VirtualLexer>;" << '\n';
+
+        for (const std::string& lexer_class : options.lexer_classes) {
+            code_file << "template class GeneratedParser::" << parser_class_name() << "<" << lexer_class << ">;" << '\n';
+        }
+
+        if (options.generate_lexer) {
+            code_file << "template class GeneratedParser::" << parser_class_name() << "<DFALexer>;" << '\n';
+        }
+    }
+
+    return status;
+}
+
+bool Generator::generate_parse_functions(std::ostream& code_file) {
+    bool status = false;
+
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    GrammarIR& ir = grammar.get_ir();
+    for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+        const std::string& nonterminal = symbol_table.get_nonterminal_name(nonterminal_id);
+        int production = ir.get_production(nonterminal_id);
+
+        code_file << "// " << nonterminal << " ::= " << ir.to_string(production, symbol_table) << '\n';
+        code_file << "template <typename Lexer>" << '\n';
+        code_file << "void " << parser_class_name() << "<Lexer>::parse_" << nonterminal << "(" << parse_function_parameters() << ") {" << '\n';
+
+        // The span of each node lets reparse() find the nodes an edit touched, and reuse the others
+        if (options.incremental) {
+            code_file << "\tif (reuse_subtree(" << nonterminal_kind_names[nonterminal_id] << ", parse_tree_parent)) {" << '\n';
+            code_file << "\t\treturn;" << '\n';
+            code_file << "\t}" << '\n';
+            code_file << '\n';
+            code_file << "\tsize_t first_token = lexer.get_token_index();" << '\n';
+        }
+
+        code_file << "\t// next_token points at the lexer's tokens so it can be moved on without copying them" << '\n';
+        code_file << "\tconst LexerToken* next_token = &lexer.peak_next_token();" << '\n';
+        code_file << '\n';
+
+        // Add the code to construct the parse tree
+        if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+            code_file << "\tint new_node = flat_tree.add_node(" << nonterminal_kind_names[nonterminal_id] << ", parse_tree_parent, -1);" << '\n';
+        } else if (options.tree_type == GeneratorOptions::EVENTS) {
+            code_file << "\thandler.enter(" << nonterminal_kind_names[nonterminal_id] << ");" << '\n';
+        } else {
+            code_file << "\tParseTreeNode* new_node = tree_arena.create_node(\"" << nonterminal << "\");" << '\n';
+
+            // Without exceptions the parent is trusted, as it always comes from the calling parse function
+            if (options.error_recovery) {
+                code_file << "\tparse_tree_parent->add_child(new_node, tree_arena);" << '\n';
+            } else {
+                code_file << "\tif (parse_tree_parent == nullptr) {" << '\n';
+                code_file << "\t\tthrow InternalErrorException(\"Parse tree node pointer is nullptr\");" << '\n';
+                code_file << "\t} else {" << '\n';
+                code_file << "\t\tparse_tree_parent->add_child(new_node, tree_arena);" << '\n';
+                code_file << "\t}" << '\n';
+            }
+        }
+        code_file << '\n';
+
+        current_nonterminal_id = nonterminal_id;
+        has_recovery_label = false;
+
+        status = generate_production_code(code_file, production, 1);
+        code_file << '\n';
+
+        // Errors jump here once the input is back in step, to finish the nonterminal early
+        if (has_recovery_label) {
+            code_file << "end_of_nonterminal:" << '\n';
+
+            if (options.tree_type == GeneratorOptions::POINTER_TREE) {
+                code_file << "\treturn;" << '\n';
+            }
+        }
+
+        if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+            code_file << "\tflat_tree.close_node(new_node);" << '\n';
+        } else if (options.tree_type == GeneratorOptions::EVENTS) {
+            code_file << "\thandler.exit(" << nonterminal_kind_names[nonterminal_id] << ");" << '\n';
+        } else if (options.incremental) {
+            code_file << "\tnew_node->set_span(" << nonterminal_kind_names[nonterminal_id] << ", lexer.get_token_index() - first_token);" << '\n';
+        }
+
+        code_file << "}" << "\n\n";
+
+        if (status == false) {
+            break;
+        }
     }
 
     return status;
 }
 
-bool Generator::generate_production_code(std::ofstream& code_file, EBNFToken* ebnf_token, int indentation_level) {
-    if (ebnf_token == nullptr) {
+bool Generator::generate_production_code(std::ostream& code_file, int node_index, int indentation_level) {
+    GrammarIR& ir = grammar.get_ir();
+
+    if (node_index < 0 || node_index >= ir.get_node_count()) {
         spdlog::error("Internal error. EBNF parser tree invalid while generating parser code");
         return false;
     }
 
     bool success = false;
 
-    spdlog::trace("Generating code from `{}`", ebnf_token->to_string());
+    COMP3931_TRACE("Generating code from `{}`", ir.to_string(node_index, grammar.get_symbol_table()));
 
-    std::vector<EBNFToken*>& ebnf_token_children = ebnf_token->get_children();
+    const GrammarIR::Node& node = ir.get_node(node_index);
 
-    switch (ebnf_token->get_type()) {
+    switch (node.type) {
         case EBNFToken::TokenType::SEQUENCE:
-            for (int i = 0; i < ebnf_token_children.size(); i++) {
-                success = generate_production_code(code_file, ebnf_token_children[i], indentation_level);
+            for (int i = 0; i < node.child_count; i++) {
+                success = generate_production_code(code_file, node.first_child + i, indentation_level);
 
-                code_file << std::endl;
+                code_file << '\n';
 
                 if (success == false) {
                     break;
                 }
             }
             break;
-        case EBNFToken::TokenType::TERMINAL:
-            // Handle cases of epsilon, string_literal, identifier, integer_constant
-            if (ebnf_token->get_value() == "epsilon") {
-                code_file << "// Produces epsilon so do nothing" << std::endl;
-                code_file << "new_node->add_child(new ParseTreeNode(\"epsilon\"));" << std::endl;
-                success = true;
+        case EBNFToken::TokenType::TERMINAL: {
+            const std::string& terminal = grammar.get_symbol_table().get_terminal_name(node.symbol_id);
+
+            if (node.symbol_id == SymbolTable::EPSILON_ID) {
+                indent(code_file, indentation_level);
+                code_file << "// Produces epsilon so do nothing" << '\n';
+                generate_leaf_code(code_file, node.symbol_id, indentation_level);
+            } else if (options.error_recovery) {
+                // Only take the token if it matches, so recovery can start from it
+                indent(code_file, indentation_level);
+                code_file << "next_token = &lexer.peak_next_token();" << '\n';
+                indent(code_file, indentation_level);
+                code_file << "if (next_token->get_kind() == " << token_kind_names[node.symbol_id] << ") {" << '\n';
+                indent(code_file, indentation_level + 1);
+                code_file << "next_token = &lexer.get_next_token();" << '\n';
+                generate_leaf_code(code_file, node.symbol_id, indentation_level + 1);
+                indent(code_file, indentation_level);
+                code_file << "} else {" << '\n';
+                generate_error_code(code_file, "\"" + escape_string(terminal) + "\"", indentation_level + 1);
+                indent(code_file, indentation_level);
+                code_file << "}" << '\n';
             } else {
                 indent(code_file, indentation_level);
-                code_file << "next_token = lexer.get_next_token();" << std::endl;
+                code_file << "next_token = &lexer.get_next_token();" << '\n';
                 indent(code_file, indentation_level);
-
-                if (ebnf_token->get_value() == "numeric_constant") {
-                   code_file << "if (next_token.get_token_type() == \"NUMERIC_CONSTANT\") {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "ParseTreeNode* tmp_node = new ParseTreeNode(\"NUMERIC_CONSTANT\");" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "tmp_node->add_child(new ParseTreeNode(next_token.get_lexeme()));" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "new_node->add_child(tmp_node);" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "} else {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "parsing_error(next_token, \"" << ebnf_token->get_value() << "\");" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "}" << std::endl;
-               } else if (ebnf_token->get_value() == "string_literal") {
-                   code_file << "if (next_token.get_token_type() == \"STRING_LITERAL\") {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "ParseTreeNode* tmp_node = new ParseTreeNode(\"STRING_LITERAL\");" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "tmp_node->add_child(new ParseTreeNode(next_token.get_lexeme()));" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "new_node->add_child(tmp_node);" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "} else {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "parsing_error(next_token, \"" << ebnf_token->get_value() << "\");" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "}" << std::endl;
-               } else if (ebnf_token->get_value() == "identifier") {
-                   code_file << "if (next_token.get_token_type() == \"IDENTIFIER\") {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "ParseTreeNode* tmp_node = new ParseTreeNode(\"IDENTIFIER\");" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "tmp_node->add_child(new ParseTreeNode(next_token.get_lexeme()));" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "new_node->add_child(tmp_node);" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "} else {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "parsing_error(next_token, \"" << ebnf_token->get_value() << "\");" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "}" << std::endl;
-               } else {
-                   code_file << "if (next_token.get_lexeme() == \"" << ebnf_token->get_value() << "\") {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "new_node->add_child(new ParseTreeNode(\"" << ebnf_token->get_value() << "\"));" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "} else {" << std::endl;
-                   indent(code_file, indentation_level + 1);
-                   code_file << "parsing_error(next_token, \"" << ebnf_token->get_value() << "\");" << std::endl;
-                   indent(code_file, indentation_level);
-                   code_file << "}" << std::endl;
-               }
-               success = true;
+                code_file << "if (next_token->get_kind() == " << token_kind_names[node.symbol_id] << ") {" << '\n';
+                generate_leaf_code(code_file, node.symbol_id, indentation_level + 1);
+                indent(code_file, indentation_level);
+                code_file << "} else {" << '\n';
+                generate_error_code(code_file, "\"" + escape_string(terminal) + "\"", indentation_level + 1);
+                indent(code_file, indentation_level);
+                code_file << "}" << '\n';
             }
-            break;
+
+            success = true;
+        }
+        break;
         case EBNFToken::TokenType::NONTERMINAL:
             indent(code_file, indentation_level);
-            code_file << "parse_" << ebnf_token->get_value() << "(new_node);";
+            code_file << "parse_" << grammar.get_symbol_table().get_nonterminal_name(node.symbol_id) << "(" << (options.tree_type == GeneratorOptions::EVENTS ? "" : "new_node") << ");" << '\n';
             success = true;
             break;
         case EBNFToken::TokenType::OR: {
-            // Check for first / first conflicts
-            std::set<std::set<std::string>> all_first_sets = std::set<std::set<std::string>>();
-            std::set<std::string> first_set;
-            for (int i = 0; i < ebnf_token_children.size(); i++) {
-                first_set = grammar.calculate_first_set(ebnf_token_children[i]);
-
-                // Check the sets are disjoint
-                for (const std::set<std::string>& other_first_set : all_first_sets) {
-                    for (const std::string& symbol : first_set) {
-                        if (other_first_set.count(symbol) != 0) {
-                            // Sets are not disjoint: symbol is in both first_set and other_first_set
-                            spdlog::error("First/First conflict detected for `{}`. Symbol `{}` appears in more than one First set.", ebnf_token->to_string(), symbol);
-                            return false;
-                        }
-                    }
-                }
-
-                all_first_sets.insert(first_set);
-            }
-
-            // Generate the approriate code
-            bool is_first = true;
+            // Generate the approriate code. Each alternative is a case of a switch on the kind of the next token
             indent(code_file, indentation_level);
-            code_file << "next_token = lexer.peak_next_token();" << std::endl;
-            for (int i = 0; i < ebnf_token_children.size(); i++) {
-                first_set = grammar.calculate_first_set(ebnf_token_children[i]);
-                first_set.erase("epsilon");     // Remove epsilon because it doesn't actually appear in the input stream
+            code_file << "next_token = &lexer.peak_next_token();" << '\n';
+            indent(code_file, indentation_level);
+            code_file << "switch (next_token->get_kind()) {" << '\n';
+
+            for (int i = 0; i < node.child_count; i++) {
+                SymbolSet first_set = ir.get_first_set(node.first_child + i);
+                first_set.erase(SymbolTable::EPSILON_ID);     // Remove epsilon because it doesn't actually appear in the input stream
 
                 if (first_set.size() == 0) {
                     continue;
                 }
 
-                if (is_first == true) {
-                    indent(code_file, indentation_level);
-                    code_file << "if (";
-                    is_first = false;
-                } else {
-                    code_file << " else if (";
-                }
+                for (int id = first_set.next(0); id != -1; id = first_set.next(id + 1)) {
+                    indent(code_file, indentation_level + 1);
+                    code_file << "case " << token_kind_names[id] << ":";
 
-                int j = 0;
-                for (std::string val : first_set) {
-                    if (val == "numeric_constant") {
-                        code_file << "next_token.get_token_type() == \"NUMERIC_CONSTANT\"";
-                    } else if (val == "string_literal") {
-                        code_file << "next_token.get_token_type() == \"STRING_LITERAL\"";
-                    } else if (val == "identifier") {
-                        code_file << "next_token.get_token_type() == \"IDENTIFIER\"";
-                    } else {
-                        code_file << "next_token.get_lexeme() == \"" << val << "\"";
+                    if (first_set.next(id + 1) == -1) {
+                        code_file << " {";
                     }
 
-                    if (j == first_set.size() - 1) {
-                        code_file << ") {" << std::endl;
-                        success = generate_production_code(code_file, ebnf_token_children[i], indentation_level + 1);
-                        indent(code_file, indentation_level);
-                        code_file << "}";
+                    code_file << '\n';
+                }
 
-                        if (success == false) {
-                            return false;
-                        }
-                    } else {
-                        code_file << " || ";
-                    }
-                    j++;
+                success = generate_production_code(code_file, node.first_child + i, indentation_level + 2);
+                indent(code_file, indentation_level + 1);
+                code_file << "}" << '\n';
+                indent(code_file, indentation_level + 1);
+                code_file << "break;" << '\n';
+
+                if (success == false) {
+                    return false;
                 }
             }
 
-            first_set = grammar.calculate_first_set(ebnf_token);
-            if (first_set.count("epsilon") == 0) {
-                code_file << " else {" << std::endl;
-                indent(code_file, indentation_level + 1);
-                code_file << "parsing_error(next_token, \"" << ebnf_token->to_string() << "\");" << std::endl;
-                indent(code_file, indentation_level);
-                code_file << "}" << std::endl;
+            indent(code_file, indentation_level + 1);
+            code_file << "default:" << '\n';
+
+            if (!ir.is_nullable(node_index)) {
+                generate_error_code(code_file, "\"" + escape_string(ir.to_string(node_index, grammar.get_symbol_table())) + "\"", indentation_level + 2);
             } else {
-                code_file << " else {" << std::endl;
-                indent(code_file, indentation_level + 1);
-                code_file << "new_node->add_child(new ParseTreeNode(\"epsilon\"));" << std::endl;
-                indent(code_file, indentation_level);
-                code_file << "}" << std::endl;
+                generate_leaf_code(code_file, SymbolTable::EPSILON_ID, indentation_level + 2);
             }
 
+            indent(code_file, indentation_level + 2);
+            code_file << "break;" << '\n';
+            indent(code_file, indentation_level);
+            code_file << "}" << '\n';
+
+            success = true;
             }
             break;
         case EBNFToken::TokenType::REPEAT: {
-            std::set<std::string> first_set = grammar.calculate_first_set(ebnf_token_children[0]);
-            first_set.erase("epsilon");     // Remove epsilon because it doesn't actually appear in the input stream
+            const SymbolSet& first_set = ir.get_first_set(node.first_child);
 
-            if (first_set.size() == 0) {
+            // Epsilon doesn't actually appear in the input stream
+            if (first_set.size() == 0 || (first_set.size() == 1 && first_set.contains(SymbolTable::EPSILON_ID))) {
                 success = true;
                 break;
             }
 
             indent(code_file, indentation_level);
-            code_file << "next_token = lexer.peak_next_token();" << std::endl;
+            code_file << "next_token = &lexer.peak_next_token();" << '\n';
             indent(code_file, indentation_level);
-            code_file << "while (";
-
-            int j = 0;
-            for (std::string val : first_set) {
-                if (val == "numeric_constant") {
-                    code_file << "next_token.get_token_type() == \"NUMERIC_CONSTANT\"";
-                } else if (val == "string_literal") {
-                    code_file << "next_token.get_token_type() == \"STRING_LITERAL\"";
-                } else if (val == "identifier") {
-                    code_file << "next_token.get_token_type() == \"IDENTIFIER\"";
-                } else {
-                    code_file << "next_token.get_lexeme() == \"" << val << "\"";
-                }
-
-                if (j == first_set.size() - 1) {
-                    code_file << ") {" << std::endl;
-                    success = generate_production_code(code_file, ebnf_token_children[0], indentation_level + 1);
-                    indent(code_file, indentation_level + 1);
-                    code_file << "next_token = lexer.peak_next_token();" << std::endl;
-                    indent(code_file, indentation_level);
-                    code_file << "}";
+            code_file << "while (" << lookahead_condition(node_index, first_set) << ") {" << '\n';
+            success = generate_production_code(code_file, node.first_child, indentation_level + 1);
+            indent(code_file, indentation_level + 1);
+            code_file << "next_token = &lexer.peak_next_token();" << '\n';
+            indent(code_file, indentation_level);
+            code_file << "}" << '\n';
 
-                    if (success == false) {
-                        return false;
-                    }
-                } else {
-                    code_file << " || ";
-                }
-                j++;
+            if (success == false) {
+                return false;
             }
-
-            code_file << std::endl;
-
-            success = true;
             }
             break;
         case EBNFToken::TokenType::OPTIONAL: {
-            std::set<std::string> first_set = grammar.calculate_first_set(ebnf_token_children[0]);
-            first_set.erase("epsilon");     // Remove epsilon because it doesn't actually appear in the input stream
+            const SymbolSet& first_set = ir.get_first_set(node.first_child);
 
-            if (first_set.size() == 0) {
+            // Epsilon doesn't actually appear in the input stream
+            if (first_set.size() == 0 || (first_set.size() == 1 && first_set.contains(SymbolTable::EPSILON_ID))) {
                 success = true;
                 break;
             }
 
             indent(code_file, indentation_level);
-            code_file << "next_token = lexer.peak_next_token();" << std::endl;
+            code_file << "next_token = &lexer.peak_next_token();" << '\n';
             indent(code_file, indentation_level);
-            code_file << "if (";
-
-            int j = 0;
-            for (std::string val : first_set) {
-                if (val == "numeric_constant") {
-                    code_file << "next_token.get_token_type() == \"NUMERIC_CONSTANT\"";
-                } else if (val == "string_literal") {
-                    code_file << "next_token.get_token_type() == \"STRING_LITERAL\"";
-                } else if (val == "identifier") {
-                    code_file << "next_token.get_token_type() == \"IDENTIFIER\"";
-                } else {
-                    code_file << "next_token.get_lexeme() == \"" << val << "\"";
-                }
-
-                if (j == first_set.size() - 1) {
-                    code_file << ") {" << std::endl;
-                    success = generate_production_code(code_file, ebnf_token_children[0], indentation_level + 1);
-                    indent(code_file, indentation_level);
-                    code_file << "}";
+            code_file << "if (" << lookahead_condition(node_index, first_set) << ") {" << '\n';
+            success = generate_production_code(code_file, node.first_child, indentation_level + 1);
+            indent(code_file, indentation_level);
+            code_file << "}" << '\n';
 
-                    if (success == false) {
-                        return false;
-                    }
-                } else {
-                    code_file << " || ";
-                }
-                j++;
+            if (success == false) {
+                return false;
             }
-
-            code_file << std::endl;
-
             }
             break;
         case EBNFToken::TokenType::GROUP:
-            for (int i = 0; i < ebnf_token_children.size(); i++) {
-                success = generate_production_code(code_file, ebnf_token_children[i], indentation_level);
+            for (int i = 0; i < node.child_count; i++) {
+                success = generate_production_code(code_file, node.first_child + i, indentation_level);
 
-                code_file << std::endl;
+                code_file << '\n';
 
                 if (success == false) {
                     break;
@@ -530,8 +785,1272 @@ bool Generator::generate_production_code(std::ofstream& code_file, EBNFToken* eb
     return success;
 }
 
-void Generator::indent(std::ofstream& file, int level) {
+void Generator::indent(std::ostream& file, int level) {
     for (int i = 0; i < level; i++) {
         file << "\t";
     }
 }
+
+void Generator::create_kind_names() {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    std::set<std::string> used_names = {"TK_UNKNOWN", "NT_ROOT"};
+
+    token_kind_names.clear();
+    nonterminal_kind_names.clear();
+
+    for (int id = 0; id < symbol_table.get_terminal_count(); id++) {
+        token_kind_names.push_back(create_kind_name("TK", symbol_table.get_terminal_name(id), id, used_names));
+    }
+
+    for (int id = 0; id < symbol_table.get_nonterminal_count(); id++) {
+        nonterminal_kind_names.push_back(create_kind_name("NT", symbol_table.get_nonterminal_name(id), id, used_names));
+    }
+}
+
+std::string Generator::create_kind_name(const std::string& prefix, const std::string& symbol, int id, std::set<std::string>& used_names) {
+    std::string name = prefix;
+    bool in_word = false;
+
+    // Keep letters, digits and underscores, and spell out anything else. e.g. `<=` becomes TK_LESS_EQUALS
+    for (char c : symbol) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            if (!in_word) {
+                name += "_";
+                in_word = true;
+            }
+
+            name += std::toupper(static_cast<unsigned char>(c));
+        } else {
+            name += "_" + character_name(c);
+            in_word = false;
+        }
+    }
+
+    // Different symbols can give the same name (e.g. `class` and `CLASS`), so fall back to adding the ID
+    if (used_names.find(name) != used_names.end()) {
+        name += "_" + std::to_string(id);
+    }
+
+    used_names.insert(name);
+
+    return name;
+}
+
+void Generator::generate_kind_enums(std::ostream& header_file) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+
+    header_file << "// One kind for each terminal of the grammar. TK_UNKNOWN is for tokens which are not in the grammar" << '\n';
+    header_file << "enum TokenKind {" << '\n';
+
+    for (int id = 0; id < symbol_table.get_terminal_count(); id++) {
+        header_file << "\t" << token_kind_names[id] << " = " << id << ",\t// `" << escape_string(symbol_table.get_terminal_name(id)) << "`" << '\n';
+    }
+
+    header_file << "\tTK_UNKNOWN" << '\n';
+    header_file << "};" << "\n\n";
+
+    // Nonterminal kinds carry on from the token kinds, so a parse tree node kind can be either
+    int root_kind = symbol_table.get_terminal_count() + 1;
+
+    header_file << "// One kind for each nonterminal of the grammar, numbered after the TokenKinds" << '\n';
+    header_file << "enum NonterminalKind {" << '\n';
+    header_file << "\tNT_ROOT = " << root_kind << ",\t// Root of the parse tree, above the start symbol" << '\n';
+
+    for (int id = 0; id < symbol_table.get_nonterminal_count(); id++) {
+        header_file << "\t" << nonterminal_kind_names[id] << " = " << root_kind + 1 + id << (id + 1 < symbol_table.get_nonterminal_count() ? "," : "") << "\t// `" << escape_string(symbol_table.get_nonterminal_name(id)) << "`" << '\n';
+    }
+
+    header_file << "};" << "\n\n";
+
+    header_file << "// Find the kind of a token from its lexeme and the type given to it by the lexer" << '\n';
+    header_file << "TokenKind classify_token(std::string_view lexeme, std::string_view token_type);" << '\n';
+    header_file << "// Kind of a lexeme written literally in the grammar, e.g. a keyword or symbol, otherwise TK_UNKNOWN" << '\n';
+    header_file << "TokenKind classify_lexeme(std::string_view lexeme);" << "\n\n";
+}
+
+void Generator::generate_classify_token_function(std::ostream& code_file) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+
+    // Terminals matched by the token type rather than the lexeme
+    int numeric_constant_id = symbol_table.get_terminal_id("numeric_constant");
+    int string_literal_id = symbol_table.get_terminal_id("string_literal");
+    int identifier_id = symbol_table.get_terminal_id("identifier");
+
+    // The remaining terminals are matched by lexeme, through a hash with no collisions between them
+    std::vector<int> literal_terminals;
+
+    for (int id = 0; id < symbol_table.get_terminal_count(); id++) {
+        if (id == SymbolTable::EPSILON_ID || id == SymbolTable::EOF_ID || id == numeric_constant_id || id == string_literal_id || id == identifier_id) {
+            continue;
+        }
+
+        literal_terminals.push_back(id);
+    }
+
+    uint32_t seed = 0;
+    std::vector<int> slots;
+    std::vector<uint32_t> displacements;
+
+    if (build_terminal_hash(literal_terminals, seed, slots, displacements)) {
+        COMP3931_DEBUG("Perfect hash of {} terminals has {} slots and {} buckets with seed {}", literal_terminals.size(), slots.size(), displacements.size(), seed);
+
+        code_file << "// Perfect hash of the terminals written literally in the grammar. The hash picks a bucket, and the displacement of" << '\n';
+        code_file << "// the bucket moves its terminals to their own slots. Empty slots have an empty lexeme" << '\n';
+        code_file << "static const uint32_t TERMINAL_HASH_SEED = " << seed << "u;" << '\n';
+        code_file << "static const uint32_t TERMINAL_HASH_MASK = " << slots.size() - 1 << "u;" << '\n';
+        code_file << "static const uint32_t TERMINAL_BUCKET_MASK = " << displacements.size() - 1 << "u;" << "\n\n";
+        code_file << source_terminal_hash_function << "\n\n";
+
+        code_file << "static const uint16_t terminal_displacements[] = {" << '\n';
+
+        for (size_t bucket = 0; bucket < displacements.size(); bucket++) {
+            code_file << (bucket % 16 == 0 ? "\t" : " ") << displacements[bucket] << ",";
+
+            if (bucket % 16 == 15 || bucket + 1 == displacements.size()) {
+                code_file << '\n';
+            }
+        }
+
+        code_file << "};" << "\n\n";
+
+        code_file << "struct TerminalHashSlot {" << '\n';
+        code_file << "\tstd::string_view lexeme;" << '\n';
+        code_file << "\tTokenKind kind;" << '\n';
+        code_file << "};" << "\n\n";
+
+        code_file << "static const TerminalHashSlot terminal_hash_table[] = {" << '\n';
+
+        for (int id : slots) {
+            if (id == -1) {
+                code_file << "\t{\"\", TK_UNKNOWN}," << '\n';
+            } else {
+                code_file << "\t{\"" << escape_string(symbol_table.get_terminal_name(id)) << "\", " << token_kind_names[id] << "}," << '\n';
+            }
+        }
+
+        code_file << "};" << "\n\n";
+
+        code_file << "TokenKind GeneratedParser::classify_lexeme(std::string_view lexeme) {" << '\n';
+        code_file << "\tuint32_t hash = terminal_hash(lexeme);" << '\n';
+        code_file << "\tconst TerminalHashSlot& slot = terminal_hash_table[terminal_displace(hash, terminal_displacements[hash & TERMINAL_BUCKET_MASK]) & TERMINAL_HASH_MASK];" << '\n';
+        code_file << "\treturn slot.lexeme == lexeme ? slot.kind : TK_UNKNOWN;" << '\n';
+        code_file << "}" << "\n\n";
+    } else {
+        // Binary search the terminals sorted by lexeme instead
+        std::sort(literal_terminals.begin(), literal_terminals.end(), [&symbol_table](int a, int b) { return symbol_table.get_terminal_name(a) < symbol_table.get_terminal_name(b); });
+
+        code_file << "// Terminals written literally in the grammar, sorted by lexeme" << '\n';
+        code_file << "struct TerminalHashSlot {" << '\n';
+        code_file << "\tstd::string_view lexeme;" << '\n';
+        code_file << "\tTokenKind kind;" << '\n';
+        code_file << "};" << "\n\n";
+
+        code_file << "static const TerminalHashSlot sorted_terminals[] = {" << '\n';
+
+        for (int id : literal_terminals) {
+            code_file << "\t{\"" << escape_string(symbol_table.get_terminal_name(id)) << "\", " << token_kind_names[id] << "}," << '\n';
+        }
+
+        code_file << "\t{\"\", TK_UNKNOWN}" << '\n';
+        code_file << "};" << "\n\n";
+
+        code_file << "TokenKind GeneratedParser::classify_lexeme(std::string_view lexeme) {" << '\n';
+        code_file << "\tconst TerminalHashSlot* end = sorted_terminals + " << literal_terminals.size() << ";" << '\n';
+        code_file << "\tconst TerminalHashSlot* slot = std::lower_bound(sorted_terminals, end, lexeme, [](const TerminalHashSlot& entry, std::string_view key) { return entry.lexeme < key; });" << '\n';
+        code_file << "\treturn slot != end && slot->lexeme == lexeme ? slot->kind : TK_UNKNOWN;" << '\n';
+        code_file << "}" << "\n\n";
+    }
+
+    code_file << "TokenKind GeneratedParser::classify_token(std::string_view lexeme, std::string_view token_type) {" << '\n';
+
+    if (string_literal_id != -1) {
+        code_file << "\t// The contents of a string never match a keyword or symbol" << '\n';
+        code_file << "\tif (token_type == \"STRING_LITERAL\") {" << '\n';
+        code_file << "\t\treturn " << token_kind_names[string_literal_id] << ";" << '\n';
+        code_file << "\t}" << "\n\n";
+    }
+
+    code_file << "\tTokenKind kind = classify_lexeme(lexeme);" << '\n';
+    code_file << "\tif (kind != TK_UNKNOWN) {" << '\n';
+    code_file << "\t\treturn kind;" << '\n';
+    code_file << "\t}" << "\n\n";
+
+    if (numeric_constant_id != -1) {
+        code_file << "\tif (token_type == \"NUMERIC_CONSTANT\") {" << '\n';
+        code_file << "\t\treturn " << token_kind_names[numeric_constant_id] << ";" << '\n';
+        code_file << "\t}" << '\n';
+    }
+
+    if (identifier_id != -1) {
+        code_file << "\tif (token_type == \"IDENTIFIER\") {" << '\n';
+        code_file << "\t\treturn " << token_kind_names[identifier_id] << ";" << '\n';
+        code_file << "\t}" << '\n';
+    }
+
+    code_file << "\tif (token_type == \"EOF\") {" << '\n';
+    code_file << "\t\treturn " << token_kind_names[SymbolTable::EOF_ID] << ";" << '\n';
+    code_file << "\t}" << "\n\n";
+
+    code_file << "\treturn TK_UNKNOWN;" << '\n';
+    code_file << "}" << "\n\n";
+}
+
+// Must give the same value as terminal_hash() in source_terminal_hash_function
+uint32_t Generator::terminal_hash(const std::string& lexeme, uint32_t seed) {
+    uint32_t hash = seed;
+
+    for (char c : lexeme) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+
+    return hash ^ (hash >> 16);
+}
+
+// Must give the same value as terminal_displace() in source_terminal_hash_function
+uint32_t Generator::terminal_displace(uint32_t hash, uint32_t displacement) {
+    uint32_t slot = hash + displacement;
+
+    slot = (slot ^ (slot >> 16)) * 0x7feb352du;
+    slot = (slot ^ (slot >> 15)) * 0x846ca68bu;
+
+    return slot ^ (slot >> 16);
+}
+
+bool Generator::build_terminal_hash(const std::vector<int>& literal_terminals, uint32_t& seed, std::vector<int>& slots, std::vector<uint32_t>& displacements) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    // Displacements are written as uint16_t
+    const uint32_t max_displacement = 65536;
+    const uint32_t max_hash_seeds = 100;
+    size_t terminal_count = literal_terminals.size();
+
+    // A table at most 80% full, and about two terminals in each bucket. Both are powers of two, so they are masks
+    uint32_t table_size = 1;
+    uint32_t bucket_count = 1;
+
+    while (table_size < terminal_count + terminal_count / 4) {
+        table_size *= 2;
+    }
+
+    while (bucket_count < terminal_count / 2) {
+        bucket_count *= 2;
+    }
+
+    // The table is only doubled once, so it stays within five slots for every two terminals
+    for (uint32_t size = table_size; size <= 2 * table_size; size *= 2) {
+        for (seed = 1; seed <= max_hash_seeds; seed++) {
+            std::vector<uint32_t> hashes;
+            std::vector<std::vector<int>> buckets(bucket_count);
+
+            for (size_t i = 0; i < terminal_count; i++) {
+                hashes.push_back(terminal_hash(symbol_table.get_terminal_name(literal_terminals[i]), seed));
+                buckets[hashes[i] & (bucket_count - 1)].push_back(i);
+            }
+
+            // Place the fullest buckets first, while most slots are free
+            std::vector<uint32_t> order;
+
+            for (uint32_t bucket = 0; bucket < bucket_count; bucket++) {
+                order.push_back(bucket);
+            }
+
+            std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+            slots.assign(size, -1);
+            displacements.assign(bucket_count, 0);
+            bool placed_all = true;
+
+            for (uint32_t bucket : order) {
+                const std::vector<int>& members = buckets[bucket];
+                bool placed = members.empty();
+                std::vector<uint32_t> positions;
+
+                for (uint32_t displacement = 0; displacement < max_displacement && !placed; displacement++) {
+                    positions.clear();
+                    placed = true;
+
+                    for (int i : members) {
+                        uint32_t position = terminal_displace(hashes[i], displacement) & (size - 1);
+
+                        if (slots[position] != -1 || std::find(positions.begin(), positions.end(), position) != positions.end()) {
+                            placed = false;
+                            break;
+                        }
+
+                        positions.push_back(position);
+                    }
+
+                    if (placed) {
+                        displacements[bucket] = displacement;
+                    }
+                }
+
+                if (!placed) {
+                    placed_all = false;
+                    break;
+                }
+
+                for (size_t i = 0; i < members.size(); i++) {
+                    slots[positions[i]] = literal_terminals[members[i]];
+                }
+            }
+
+            if (placed_all) {
+                return true;
+            }
+        }
+    }
+
+    spdlog::warn("No perfect hash found for the {} literal terminals, so classify_lexeme() uses a binary search", terminal_count);
+    return false;
+}
+
+void Generator::generate_error_code(std::ostream& code_file, const std::string& expected_value, int indentation_level) {
+    indent(code_file, indentation_level);
+    code_file << "parsing_error(*next_token, " << expected_value << ");" << '\n';
+
+    if (options.error_recovery) {
+        indent(code_file, indentation_level);
+        code_file << "synchronize(follow_sets + " << current_nonterminal_id << " * FOLLOW_SET_WORDS);" << '\n';
+        indent(code_file, indentation_level);
+        code_file << "goto end_of_nonterminal;" << '\n';
+        has_recovery_label = true;
+    }
+}
+
+void Generator::generate_follow_sets(std::ostream& code_file) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    int word_count = symbol_table.get_terminal_count() / 64 + 1;
+
+    code_file << "// Follow set of each nonterminal, where parsing starts again after an error" << '\n';
+    code_file << "static const int FOLLOW_SET_WORDS = " << word_count << ";" << '\n';
+    code_file << "static const uint64_t follow_sets[] = {" << '\n';
+
+    for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+        code_file << "\t" << bitmask_words(grammar.get_follow_set(nonterminal_id), word_count) << ",\t// " << escape_string(symbol_table.get_nonterminal_name(nonterminal_id)) << '\n';
+    }
+
+    code_file << "};" << "\n\n";
+}
+
+std::string Generator::bitmask_words(const SymbolSet& symbol_set, int word_count) {
+    const std::vector<uint64_t>& words = symbol_set.get_words();
+    std::string bitmask = "";
+
+    for (int i = 0; i < word_count; i++) {
+        char word[32];
+        snprintf(word, sizeof(word), "0x%016llxULL", static_cast<unsigned long long>(i < static_cast<int>(words.size()) ? words[i] : 0));
+
+        bitmask += (i == 0 ? "" : ", ") + std::string(word);
+    }
+
+    return bitmask;
+}
+
+bool Generator::check_alternatives(Grammar& grammar, int node_index) {
+    GrammarIR& ir = grammar.get_ir();
+    const GrammarIR::Node& node = ir.get_node(node_index);
+
+    // Check for first / first conflicts
+    SymbolSet all_first_sets = SymbolSet(grammar.get_symbol_table().get_terminal_count());
+    for (int i = 0; i < node.child_count; i++) {
+        const SymbolSet& child_first_set = ir.get_first_set(node.first_child + i);
+
+        // Check the sets are disjoint
+        int symbol = child_first_set.first_common(all_first_sets);
+        if (symbol != -1) {
+            // Sets are not disjoint: symbol is in both this First set and an earlier one
+            spdlog::error("First/First conflict detected for `{}`. Symbol `{}` appears in more than one First set.", ir.to_string(node_index, grammar.get_symbol_table()), grammar.get_symbol_table().get_terminal_name(symbol));
+            return false;
+        }
+
+        all_first_sets.unite(child_first_set);
+    }
+
+    return true;
+}
+
+void Generator::build_predictions(Grammar& grammar, std::vector<int>& decisions, std::vector<std::vector<int>>& rows) {
+    GrammarIR& ir = grammar.get_ir();
+    int row_size = grammar.get_symbol_table().get_terminal_count() + 1;
+    std::map<std::vector<int>, int> row_indices;
+
+    decisions.assign(ir.get_node_count(), -1);
+    rows.clear();
+
+    // Many decisions have the same row (e.g. every OPTIONAL starting with the same terminal) so rows are shared
+    for (int node_index = 0; node_index < ir.get_node_count(); node_index++) {
+        const GrammarIR::Node& node = ir.get_node(node_index);
+        std::vector<int> row(row_size, -1);
+
+        if (node.type == EBNFToken::TokenType::OR) {
+            for (int i = 0; i < node.child_count; i++) {
+                const SymbolSet& first_set = ir.get_first_set(node.first_child + i);
+
+                // Epsilon doesn't actually appear in the input stream
+                for (int id = first_set.next(0); id != -1; id = first_set.next(id + 1)) {
+                    if (id != SymbolTable::EPSILON_ID) {
+                        row[id] = i;
+                    }
+                }
+            }
+        } else if (node.type == EBNFToken::TokenType::REPEAT || node.type == EBNFToken::TokenType::OPTIONAL) {
+            const SymbolSet& first_set = ir.get_first_set(node.first_child);
+
+            for (int id = first_set.next(0); id != -1; id = first_set.next(id + 1)) {
+                if (id != SymbolTable::EPSILON_ID) {
+                    row[id] = 0;
+                }
+            }
+        } else {
+            continue;
+        }
+
+        auto inserted = row_indices.insert(std::make_pair(row, rows.size()));
+
+        if (inserted.second) {
+            rows.push_back(row);
+        }
+
+        decisions[node_index] = inserted.first->second;
+    }
+
+    // A grammar without any decisions still needs a row, as an array cannot be empty
+    if (rows.empty()) {
+        rows.push_back(std::vector<int>(row_size, -1));
+    }
+}
+
+bool Generator::generate_parse_tables(std::ostream& code_file) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    GrammarIR& ir = grammar.get_ir();
+    int row_size = symbol_table.get_terminal_count() + 1;
+    int max_child_count = 0;
+    std::vector<int> decisions;
+    std::vector<std::vector<int>> rows;
+
+    build_predictions(grammar, decisions, rows);
+
+    for (int node_index = 0; node_index < ir.get_node_count(); node_index++) {
+        max_child_count = std::max(max_child_count, ir.get_node(node_index).child_count);
+    }
+
+    COMP3931_DEBUG("Parse tables have {} nodes and {} prediction rows of {} kinds", ir.get_node_count(), rows.size(), row_size);
+
+    // The smallest type which can hold every child index and NO_PREDICTION
+    std::string prediction_type = max_child_count < 255 ? "uint8_t" : max_child_count < 65535 ? "uint16_t" : "uint32_t";
+    std::string no_prediction = max_child_count < 255 ? "0xFF" : max_child_count < 65535 ? "0xFFFF" : "0xFFFFFFFF";
+
+    code_file << "// Parse tables. The grammar is stored as a tree of nodes where the children of a node are next to each other" << '\n';
+    code_file << "enum TableNodeType : uint8_t {" << '\n';
+    code_file << "\tTABLE_SEQUENCE," << '\n';
+    code_file << "\tTABLE_TERMINAL," << '\n';
+    code_file << "\tTABLE_NONTERMINAL," << '\n';
+    code_file << "\tTABLE_OR," << '\n';
+    code_file << "\tTABLE_REPEAT," << '\n';
+    code_file << "\tTABLE_OPTIONAL," << '\n';
+    code_file << "\tTABLE_GROUP" << '\n';
+    code_file << "};" << "\n\n";
+
+    code_file << "struct TableNode {" << '\n';
+    code_file << "\tTableNodeType type;" << '\n';
+    code_file << "\tbool nullable;" << '\n';
+    code_file << "\t// TokenKind of a terminal or ID of a nonterminal" << '\n';
+    code_file << "\tint symbol;" << '\n';
+    code_file << "\tint first_child;" << '\n';
+    code_file << "\tint child_count;" << '\n';
+    code_file << "\t// Row of prediction_table for OR, REPEAT and OPTIONAL nodes" << '\n';
+    code_file << "\tint decision;" << '\n';
+    code_file << "};" << "\n\n";
+
+    code_file << "static const TableNode table_nodes[] = {" << '\n';
+
+    for (int node_index = 0; node_index < ir.get_node_count(); node_index++) {
+        const GrammarIR::Node& node = ir.get_node(node_index);
+        std::string type_name;
+
+        switch (node.type) {
+            case EBNFToken::TokenType::SEQUENCE: type_name = "TABLE_SEQUENCE"; break;
+            case EBNFToken::TokenType::TERMINAL: type_name = "TABLE_TERMINAL"; break;
+            case EBNFToken::TokenType::NONTERMINAL: type_name = "TABLE_NONTERMINAL"; break;
+            case EBNFToken::TokenType::OR: type_name = "TABLE_OR"; break;
+            case EBNFToken::TokenType::REPEAT: type_name = "TABLE_REPEAT"; break;
+            case EBNFToken::TokenType::OPTIONAL: type_name = "TABLE_OPTIONAL"; break;
+            case EBNFToken::TokenType::GROUP: type_name = "TABLE_GROUP"; break;
+            default:
+                spdlog::error("Unkown type of EBNFToken when generating parse tables");
+                return false;
+        }
+
+        code_file << "\t{" << type_name << ", " << (ir.is_nullable(node_index) ? "true" : "false") << ", " << node.symbol_id << ", " << node.first_child << ", " << node.child_count << ", " << decisions[node_index] << "},\t// " << node_index << '\n';
+    }
+
+    code_file << "};" << "\n\n";
+
+    // Root node of each nonterminal's production
+    code_file << "static const int production_roots[] = {" << '\n';
+
+    for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+        code_file << "\t" << ir.get_production(nonterminal_id) << ",\t// " << escape_string(symbol_table.get_nonterminal_name(nonterminal_id)) << '\n';
+    }
+
+    code_file << "};" << "\n\n";
+
+    // Expected value reported when a terminal or OR does not match
+    code_file << "static const char* const expected_values[] = {" << '\n';
+
+    for (int node_index = 0; node_index < ir.get_node_count(); node_index++) {
+        const GrammarIR::Node& node = ir.get_node(node_index);
+
+        if (node.type == EBNFToken::TokenType::TERMINAL) {
+            code_file << "\t\"" << escape_string(symbol_table.get_terminal_name(node.symbol_id)) << "\"," << '\n';
+        } else if (node.type == EBNFToken::TokenType::OR && !ir.is_nullable(node_index)) {
+            code_file << "\t\"" << escape_string(ir.to_string(node_index, symbol_table)) << "\"," << '\n';
+        } else {
+            code_file << "\tnullptr," << '\n';
+        }
+    }
+
+    code_file << "};" << "\n\n";
+
+    code_file << "typedef " << prediction_type << " Prediction;" << '\n';
+    code_file << "static const Prediction NO_PREDICTION = " << no_prediction << ";" << '\n';
+    code_file << "static const int PREDICTION_ROW_SIZE = " << row_size << ";" << "\n\n";
+
+    code_file << "// Child of a decision node to parse for each TokenKind, one row of PREDICTION_ROW_SIZE per decision" << '\n';
+    code_file << "static const Prediction prediction_table[] = {" << '\n';
+
+    for (const std::vector<int>& row : rows) {
+        code_file << "\t";
+
+        for (int prediction : row) {
+            if (prediction == -1) {
+                code_file << "NO_PREDICTION, ";
+            } else {
+                code_file << prediction << ", ";
+            }
+        }
+
+        code_file << '\n';
+    }
+
+    code_file << "};" << "\n\n";
+
+    return true;
+}
+
+void Generator::generate_table_driver(std::ostream& code_file) {
+    bool build_tree = options.tree_type != GeneratorOptions::EVENTS;
+    int start_id = grammar.get_symbol_table().get_nonterminal_id(grammar.get_start_symbol());
+
+    code_file << "// Parse with an explicit stack of the grammar nodes in progress instead of recursion, so nesting is only limited by memory." << '\n';
+    code_file << "// pending is the next node to parse, or -1 to carry on with the frame on top of the stack" << '\n';
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "void " << parser_class_name() << "<Lexer>::run_parse_table(" << parse_function_parameters() << ") {" << '\n';
+    code_file << "\tconst LexerToken* next_token = &lexer.peak_next_token();" << '\n';
+    code_file << "\tint pending = production_roots[" << start_id << "];" << '\n';
+    code_file << '\n';
+
+    // The start symbol is the first nonterminal frame
+    code_file << "\tparse_stack.clear();" << '\n';
+
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << "\tint new_node = flat_tree.add_node(" << nonterminal_kind_names[start_id] << ", parse_tree_parent, -1);" << '\n';
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        code_file << "\thandler.enter(" << nonterminal_kind_names[start_id] << ");" << '\n';
+    } else {
+        code_file << "\tParseTreeNode* new_node = tree_arena.create_node(node_kind_label(" << nonterminal_kind_names[start_id] << "));" << '\n';
+        code_file << "\tparse_tree_parent->add_child(new_node, tree_arena);" << '\n';
+    }
+
+    code_file << "\tparse_stack.push_back({-1, 0, " << start_id << (build_tree ? ", new_node" : "") << "});" << '\n';
+    code_file << '\n';
+    code_file << "\twhile (true) {" << '\n';
+    code_file << "\t\tif (pending == -1) {" << '\n';
+    code_file << "\t\t\tif (parse_stack.empty()) {" << '\n';
+    code_file << "\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t\t}" << "\n\n";
+    code_file << "\t\t\tParseFrame& frame = parse_stack.back();" << '\n';
+
+    if (build_tree) {
+        code_file << "\t\t\tnew_node = frame.tree_node;" << '\n';
+    }
+
+    code_file << '\n';
+    code_file << "\t\t\t// The nonterminal is finished" << '\n';
+    code_file << "\t\t\tif (frame.nonterminal != -1) {" << '\n';
+
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << "\t\t\t\tflat_tree.close_node(frame.tree_node);" << '\n';
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        code_file << "\t\t\t\thandler.exit(static_cast<NonterminalKind>(NT_ROOT + 1 + frame.nonterminal));" << '\n';
+    }
+
+    code_file << "\t\t\t\tparse_stack.pop_back();" << '\n';
+    code_file << "\t\t\t\tcontinue;" << '\n';
+    code_file << "\t\t\t}" << "\n\n";
+    code_file << "\t\t\tconst TableNode& node = table_nodes[frame.node];" << "\n\n";
+    code_file << "\t\t\tif (node.type == TABLE_REPEAT) {" << '\n';
+    code_file << "\t\t\t\tnext_token = &lexer.peak_next_token();" << '\n';
+    code_file << "\t\t\t\tif (prediction_table[node.decision * PREDICTION_ROW_SIZE + next_token->get_kind()] != NO_PREDICTION) {" << '\n';
+    code_file << "\t\t\t\t\tpending = node.first_child;" << '\n';
+    code_file << "\t\t\t\t} else {" << '\n';
+    code_file << "\t\t\t\t\tparse_stack.pop_back();" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t} else {" << '\n';
+    code_file << "\t\t\t\tpending = node.first_child + frame.next_child++;" << "\n\n";
+    code_file << "\t\t\t\t// Nothing is left to do after the last child, so the frame can go now" << '\n';
+    code_file << "\t\t\t\tif (frame.next_child == node.child_count) {" << '\n';
+    code_file << "\t\t\t\t\tparse_stack.pop_back();" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t}" << "\n\n";
+    code_file << "\t\t\tcontinue;" << '\n';
+    code_file << "\t\t}" << "\n\n";
+    code_file << "\t\tconst TableNode& node = table_nodes[pending];" << '\n';
+    code_file << "\t\tint current = pending;" << '\n';
+    code_file << "\t\tpending = -1;" << "\n\n";
+    code_file << "\t\tswitch (node.type) {" << '\n';
+    code_file << "\t\t\tcase TABLE_SEQUENCE:" << '\n';
+    code_file << "\t\t\tcase TABLE_GROUP:" << '\n';
+    code_file << "\t\t\t\t// Start on the first child. A frame is only needed to come back for the rest" << '\n';
+    code_file << "\t\t\t\tif (node.child_count > 1) {" << '\n';
+    code_file << "\t\t\t\t\tparse_stack.push_back({current, 1, -1" << (build_tree ? ", new_node" : "") << "});" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t\tif (node.child_count > 0) {" << '\n';
+    code_file << "\t\t\t\t\tpending = node.first_child;" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t\tcase TABLE_REPEAT:" << '\n';
+    code_file << "\t\t\t\t// The frame checks the next token again after each repetition" << '\n';
+    code_file << "\t\t\t\tnext_token = &lexer.peak_next_token();" << '\n';
+    code_file << "\t\t\t\tif (prediction_table[node.decision * PREDICTION_ROW_SIZE + next_token->get_kind()] != NO_PREDICTION) {" << '\n';
+    code_file << "\t\t\t\t\tparse_stack.push_back({current, 0, -1" << (build_tree ? ", new_node" : "") << "});" << '\n';
+    code_file << "\t\t\t\t\tpending = node.first_child;" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t\tcase TABLE_OPTIONAL:" << '\n';
+    code_file << "\t\t\t\tnext_token = &lexer.peak_next_token();" << '\n';
+    code_file << "\t\t\t\tif (prediction_table[node.decision * PREDICTION_ROW_SIZE + next_token->get_kind()] != NO_PREDICTION) {" << '\n';
+    code_file << "\t\t\t\t\tpending = node.first_child;" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t\tcase TABLE_OR: {" << '\n';
+    code_file << "\t\t\t\tnext_token = &lexer.peak_next_token();" << '\n';
+    code_file << "\t\t\t\tPrediction alternative = prediction_table[node.decision * PREDICTION_ROW_SIZE + next_token->get_kind()];" << "\n\n";
+    code_file << "\t\t\t\tif (alternative != NO_PREDICTION) {" << '\n';
+    code_file << "\t\t\t\t\tpending = node.first_child + alternative;" << '\n';
+    code_file << "\t\t\t\t} else if (node.nullable) {" << '\n';
+    generate_leaf_code(code_file, SymbolTable::EPSILON_ID, 5);
+    code_file << "\t\t\t\t} else {" << '\n';
+    generate_table_error_code(code_file, 5);
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t\tcase TABLE_TERMINAL:" << '\n';
+    code_file << "\t\t\t\tif (node.symbol == TK_EPSILON) {" << '\n';
+    generate_leaf_code(code_file, SymbolTable::EPSILON_ID, 5);
+    code_file << "\t\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t\t\t}" << "\n\n";
+    if (options.error_recovery) {
+        // Only take the token if it matches, so recovery can start from it
+        code_file << "\t\t\t\tnext_token = &lexer.peak_next_token();" << '\n';
+        code_file << "\t\t\t\tif (next_token->get_kind() != node.symbol) {" << '\n';
+        generate_table_error_code(code_file, 5);
+        code_file << "\t\t\t\t}" << '\n';
+        code_file << "\t\t\t\tnext_token = &lexer.get_next_token();" << "\n\n";
+    } else {
+        code_file << "\t\t\t\tnext_token = &lexer.get_next_token();" << '\n';
+        code_file << "\t\t\t\tif (next_token->get_kind() != node.symbol) {" << '\n';
+        generate_table_error_code(code_file, 5);
+        code_file << "\t\t\t\t}" << "\n\n";
+    }
+
+    // Add the token to the tree, labelled the same as the recursive descent parser labels it
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << "\t\t\t\tflat_tree.add_node(node.symbol, new_node, flat_tree.add_token(*next_token));" << '\n';
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        code_file << "\t\t\t\thandler.token(next_token->get_kind(), next_token->get_lexeme());" << '\n';
+    } else {
+        std::string lexeme_condition = lexeme_kind_condition("node.symbol");
+
+        code_file << "\t\t\t\tif (" << (lexeme_condition == "" ? "false" : lexeme_condition) << ") {" << '\n';
+        code_file << "\t\t\t\t\tParseTreeNode* tmp_node = tree_arena.create_node(node_kind_label(node.symbol));" << '\n';
+        code_file << "\t\t\t\t\ttmp_node->add_child(tree_arena.create_node(next_token->get_lexeme()), tree_arena);" << '\n';
+        code_file << "\t\t\t\t\tnew_node->add_child(tmp_node, tree_arena);" << '\n';
+        code_file << "\t\t\t\t} else {" << '\n';
+        code_file << "\t\t\t\t\tnew_node->add_child(tree_arena.create_node(node_kind_label(node.symbol)), tree_arena);" << '\n';
+        code_file << "\t\t\t\t}" << '\n';
+    }
+
+    code_file << "\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t\tcase TABLE_NONTERMINAL: {" << '\n';
+
+    if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        code_file << "\t\t\t\tnew_node = flat_tree.add_node(NT_ROOT + 1 + node.symbol, new_node, -1);" << '\n';
+    } else if (options.tree_type == GeneratorOptions::EVENTS) {
+        code_file << "\t\t\t\thandler.enter(static_cast<NonterminalKind>(NT_ROOT + 1 + node.symbol));" << '\n';
+    } else {
+        code_file << "\t\t\t\tParseTreeNode* child = tree_arena.create_node(node_kind_label(NT_ROOT + 1 + node.symbol));" << '\n';
+        code_file << "\t\t\t\tnew_node->add_child(child, tree_arena);" << '\n';
+        code_file << "\t\t\t\tnew_node = child;" << '\n';
+    }
+
+    code_file << "\t\t\t\tparse_stack.push_back({current, 0, node.symbol" << (build_tree ? ", new_node" : "") << "});" << '\n';
+    code_file << "\t\t\t\tpending = production_roots[node.symbol];" << '\n';
+    code_file << "\t\t\t\t}" << '\n';
+    code_file << "\t\t\t\tbreak;" << '\n';
+    code_file << "\t\t}" << '\n';
+    code_file << "\t}" << '\n';
+    code_file << "}" << "\n\n";
+}
+
+void Generator::generate_table_error_code(std::ostream& code_file, int indentation_level) {
+    indent(code_file, indentation_level);
+    code_file << "parsing_error(*next_token, expected_values[current]);" << '\n';
+
+    if (options.error_recovery) {
+        // Give up on the innermost nonterminal. Its frame finishes it once the input is back in step
+        indent(code_file, indentation_level);
+        code_file << "while (parse_stack.back().nonterminal == -1) {" << '\n';
+        indent(code_file, indentation_level + 1);
+        code_file << "parse_stack.pop_back();" << '\n';
+        indent(code_file, indentation_level);
+        code_file << "}" << '\n';
+        indent(code_file, indentation_level);
+        code_file << "synchronize(follow_sets + parse_stack.back().nonterminal * FOLLOW_SET_WORDS);" << '\n';
+        indent(code_file, indentation_level);
+        code_file << "break;" << '\n';
+    }
+}
+
+bool Generator::needs_node_kind_labels() {
+    // The table driven parser labels ParseTreeNodes through node_kind_label()
+    return options.tree_type != GeneratorOptions::POINTER_TREE || options.backend == GeneratorOptions::TABLE;
+}
+
+std::string Generator::tree_node_type() {
+    return options.tree_type == GeneratorOptions::FLAT_TREE ? "int" : "ParseTreeNode*";
+}
+
+std::string Generator::lexeme_kind_condition(const std::string& kind) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    std::string condition = "";
+
+    for (const char* terminal : {"numeric_constant", "string_literal", "identifier"}) {
+        int terminal_id = symbol_table.get_terminal_id(terminal);
+
+        if (terminal_id != -1) {
+            condition += (condition == "" ? "" : " || ") + kind + " == " + token_kind_names[terminal_id];
+        }
+    }
+
+    return condition;
+}
+
+void Generator::generate_node_kind_label_function(std::ostream& code_file) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+
+    // Labels match the ParseTreeNode tree, where identifiers and constants are labelled with their type
+    code_file << "std::string_view GeneratedParser::node_kind_label(int kind) {" << '\n';
+    code_file << "\tstatic const std::string_view labels[] = {" << '\n';
+
+    for (int id = 0; id < symbol_table.get_terminal_count(); id++) {
+        const std::string& terminal = symbol_table.get_terminal_name(id);
+        std::string label = terminal;
+
+        if (terminal == "numeric_constant" || terminal == "string_literal" || terminal == "identifier") {
+            for (char& c : label) {
+                c = std::toupper(static_cast<unsigned char>(c));
+            }
+        }
+
+        code_file << "\t\t\"" << escape_string(label) << "\",\t// " << token_kind_names[id] << '\n';
+    }
+
+    code_file << "\t\t\"\",\t// TK_UNKNOWN" << '\n';
+    code_file << "\t\t\"\",\t// NT_ROOT" << '\n';
+
+    for (int id = 0; id < symbol_table.get_nonterminal_count(); id++) {
+        code_file << "\t\t\"" << escape_string(symbol_table.get_nonterminal_name(id)) << "\",\t// " << nonterminal_kind_names[id] << '\n';
+    }
+
+    code_file << "\t};" << "\n\n";
+    code_file << "\tif (kind < 0 || kind >= static_cast<int>(sizeof(labels) / sizeof(labels[0]))) {" << '\n';
+    code_file << "\t\treturn \"\";" << '\n';
+    code_file << "\t}" << "\n\n";
+    code_file << "\treturn labels[kind];" << '\n';
+    code_file << "}" << "\n\n";
+}
+
+std::string Generator::parser_class_name() {
+    return "Basic" + output_file_name;
+}
+
+std::string Generator::parse_function_parameters() {
+    switch (options.tree_type) {
+        case GeneratorOptions::FLAT_TREE:
+            return "int parse_tree_parent";
+        case GeneratorOptions::EVENTS:
+            return "";
+        default:
+            return "ParseTreeNode* parse_tree_parent";
+    }
+}
+
+void Generator::generate_leaf_code(std::ostream& code_file, int terminal_id, int indentation_level) {
+    const std::string& terminal = grammar.get_symbol_table().get_terminal_name(terminal_id);
+    bool has_lexeme = terminal == "numeric_constant" || terminal == "string_literal" || terminal == "identifier";
+
+    indent(code_file, indentation_level);
+
+    if (options.tree_type == GeneratorOptions::EVENTS) {
+        // Empty alternatives are not reported to the handler
+        if (terminal_id == SymbolTable::EPSILON_ID) {
+            code_file << "// No event for epsilon" << '\n';
+        } else {
+            code_file << "handler.token(" << token_kind_names[terminal_id] << ", next_token->get_lexeme());" << '\n';
+        }
+    } else if (options.tree_type == GeneratorOptions::FLAT_TREE) {
+        // The leaf keeps the index of its token, which gives the lexeme of identifiers and constants
+        if (terminal_id == SymbolTable::EPSILON_ID) {
+            code_file << "flat_tree.add_node(" << token_kind_names[terminal_id] << ", new_node, -1);" << '\n';
+        } else {
+            code_file << "flat_tree.add_node(" << token_kind_names[terminal_id] << ", new_node, flat_tree.add_token(*next_token));" << '\n';
+        }
+    } else if (has_lexeme) {
+        // Identifiers and constants are a node labelled with the token type, with the lexeme as its child
+        std::string label = terminal;
+
+        for (char& c : label) {
+            c = std::toupper(static_cast<unsigned char>(c));
+        }
+
+        code_file << "ParseTreeNode* tmp_node = tree_arena.create_node(\"" << label << "\");" << '\n';
+        indent(code_file, indentation_level);
+        // The lexer's text changes under an incremental parser, so the lexemes of reused nodes are kept in the arena
+        if (options.incremental) {
+            code_file << "tmp_node->add_child(tree_arena.create_node(tree_arena.copy_string(next_token->get_lexeme())), tree_arena);" << '\n';
+        } else {
+            code_file << "tmp_node->add_child(tree_arena.create_node(next_token->get_lexeme()), tree_arena);" << '\n';
+        }
+        indent(code_file, indentation_level);
+        code_file << "new_node->add_child(tmp_node, tree_arena);" << '\n';
+    } else if (options.incremental && terminal_id == SymbolTable::EPSILON_ID) {
+        // An empty alternative covers no tokens
+        code_file << "new_node->add_child(tree_arena.create_node(\"" << escape_string(terminal) << "\"), tree_arena);" << '\n';
+        indent(code_file, indentation_level);
+        code_file << "new_node->get_children().end()[-1]->set_span(TK_UNKNOWN, 0);" << '\n';
+    } else {
+        code_file << "new_node->add_child(tree_arena.create_node(\"" << escape_string(terminal) << "\"), tree_arena);" << '\n';
+    }
+}
+
+void Generator::generate_tree_gnu_plot_function(std::ostream& code_file) {
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "void " << parser_class_name() << "<Lexer>::parse_tree_gnu_plot(const std::string& file_name) {" << '\n';
+    code_file << "\tstd::ofstream file = std::ofstream(file_name);" << '\n';
+    code_file << "\tif (!file) {" << '\n';
+    code_file << "\t\treturn;" << '\n';
+    code_file << "\t}" << "\n\n";
+    code_file << "\tint node_id_counter = 1;" << '\n';
+    code_file << "\tstd::queue<std::pair<int, ParseTreeNode*>> node_queue;" << '\n';
+    code_file << "\tnode_queue.push(std::pair<int, ParseTreeNode*>(-1, parse_tree_root));" << '\n';
+    code_file << '\n';
+    code_file << "\twhile (!node_queue.empty()) {" << '\n';
+    code_file << "\t\tstd::pair<int, ParseTreeNode*> current_node = node_queue.front();" << "\n\n";
+    code_file << "\t\tif (current_node.first == -1) {" << '\n';
+    code_file << "\t\t\tfile << node_id_counter << \" NaN \" << std::endl;" << '\n';
+    code_file << "\t\t} else {" << '\n';
+    code_file << "\t\t\tfile << node_id_counter << \" \" << current_node.first << \" \" << current_node.second->get_token() << std::endl;" << '\n';
+    code_file << "\t\t}" << "\n\n";
+    code_file << "\t\t for (ParseTreeNode* child : current_node.second->get_children()) {" << '\n';
+    code_file << "\t\t\t" << "node_queue.push(std::pair<int, ParseTreeNode*>(node_id_counter, child));" << '\n';
+    code_file << "\t\t}" << "\n\n";
+    code_file << "\t\tnode_id_counter++;" << '\n';
+    code_file << "\t\tnode_queue.pop();" << '\n';
+    code_file << "\t}" << '\n';
+    code_file << "}" << "\n\n";
+}
+
+void Generator::generate_flat_tree_gnu_plot_function(std::ostream& code_file) {
+    // Kinds whose lexeme is written as a child of the leaf, like the ParseTreeNode tree
+    std::string has_lexeme_condition = lexeme_kind_condition("kind");
+
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "void " << parser_class_name() << "<Lexer>::parse_tree_gnu_plot(const std::string& file_name) {" << '\n';
+    code_file << "\tstd::ofstream file = std::ofstream(file_name);" << '\n';
+    code_file << "\tif (!file || flat_tree.size() == 0) {" << '\n';
+    code_file << "\t\treturn;" << '\n';
+    code_file << "\t}" << "\n\n";
+    code_file << "\t// Breadth first so the node IDs match the ParseTreeNode version. Lexeme leaves are queued as -2 - node" << '\n';
+    code_file << "\tint node_id_counter = 1;" << '\n';
+    code_file << "\tstd::queue<std::pair<int, int>> node_queue;" << '\n';
+    code_file << "\tnode_queue.push(std::pair<int, int>(-1, 0));" << '\n';
+    code_file << '\n';
+    code_file << "\twhile (!node_queue.empty()) {" << '\n';
+    code_file << "\t\tstd::pair<int, int> current_node = node_queue.front();" << '\n';
+    code_file << "\t\tint node = current_node.second >= 0 ? current_node.second : -2 - current_node.second;" << "\n\n";
+    code_file << "\t\tif (current_node.first == -1) {" << '\n';
+    code_file << "\t\t\tfile << node_id_counter << \" NaN \" << std::endl;" << '\n';
+    code_file << "\t\t} else if (current_node.second >= 0) {" << '\n';
+    code_file << "\t\t\tfile << node_id_counter << \" \" << current_node.first << \" \" << flat_tree.get_label(node) << std::endl;" << '\n';
+    code_file << "\t\t} else {" << '\n';
+    code_file << "\t\t\tfile << node_id_counter << \" \" << current_node.first << \" \" << flat_tree.get_token(flat_tree.get_token_index(node)).get_lexeme() << std::endl;" << '\n';
+    code_file << "\t\t}" << "\n\n";
+    code_file << "\t\tif (current_node.second >= 0) {" << '\n';
+
+    if (has_lexeme_condition != "") {
+        code_file << "\t\t\tint kind = flat_tree.get_kind(node);" << '\n';
+        code_file << "\t\t\tif (" << has_lexeme_condition << ") {" << '\n';
+        code_file << "\t\t\t\tnode_queue.push(std::pair<int, int>(node_id_counter, -2 - node));" << '\n';
+        code_file << "\t\t\t}" << "\n\n";
+    }
+
+    code_file << "\t\t\tfor (int child : flat_tree.get_children(node)) {" << '\n';
+    code_file << "\t\t\t\tnode_queue.push(std::pair<int, int>(node_id_counter, child));" << '\n';
+    code_file << "\t\t\t}" << '\n';
+    code_file << "\t\t}" << "\n\n";
+    code_file << "\t\tnode_id_counter++;" << '\n';
+    code_file << "\t\tnode_queue.pop();" << '\n';
+    code_file << "\t}" << '\n';
+    code_file << "}" << "\n\n";
+}
+
+void Generator::generate_parse_files_function(std::ostream& header_file) {
+    bool events = options.tree_type == GeneratorOptions::EVENTS;
+    std::string result_name = parser_class_name() + "Result";
+    // ParserLexer picks the parser compiled for a base class of Lexer, e.g. VirtualLexer
+    std::string template_parameters = events ? "typename Lexer, typename Handler, typename ParserLexer = Lexer" : "typename Lexer, typename ParserLexer = Lexer";
+    std::string template_arguments = events ? "<Lexer, Handler, ParserLexer>" : "<Lexer, ParserLexer>";
+
+    // Each result owns its lexer and parser, so the tree it holds stays valid after parse_files() returns
+    header_file << "// Result of parsing one file with parse_files(). The parser refers to the lexer, so both are kept" << '\n';
+    header_file << "template <" << template_parameters << ">" << '\n';
+    header_file << "struct " << result_name << " {" << '\n';
+    header_file << "\tstd::string file_name;" << '\n';
+    header_file << "\tstd::unique_ptr<Lexer> lexer;" << '\n';
+
+    if (events) {
+        header_file << "\tstd::unique_ptr<Handler> handler;" << '\n';
+    }
+
+    header_file << "\tstd::unique_ptr<" << parser_class_name() << "<ParserLexer>> parser;" << '\n';
+    header_file << "\t// Empty if the file was parsed, otherwise the message of the exception thrown while lexing or parsing it" << '\n';
+    header_file << "\tstd::string error;" << '\n';
+    header_file << "};" << "\n\n";
+
+    header_file << "// Parse each file with a new Lexer(file_name)";
+
+    if (events) {
+        header_file << ", a new Handler()";
+    }
+
+    header_file << " and its own parser, on up to thread_count threads" << '\n';
+    header_file << "// (0 for one per core). The results are in the same order as file_names. ParserLexer must be Lexer or a base" << '\n';
+    header_file << "// of it which the parser is compiled for, and constructing a Lexer must not change state shared with other lexers" << '\n';
+    header_file << "template <" << template_parameters << ">" << '\n';
+    header_file << "std::vector<" << result_name << template_arguments << "> parse_files(const std::vector<std::string>& file_names, unsigned int thread_count = 0) {" << '\n';
+    header_file << "\tstd::vector<" << result_name << template_arguments << "> results(file_names.size());" << '\n';
+    header_file << "\tif (thread_count == 0) {" << '\n';
+    header_file << "\t\tthread_count = std::max(1u, std::thread::hardware_concurrency());" << '\n';
+    header_file << "\t}" << "\n\n";
+    header_file << "\t// Each thread takes the next file nobody has started and only writes to that file's result" << '\n';
+    header_file << "\tstd::atomic<size_t> next_file(0);" << '\n';
+    header_file << "\tauto parse_next_files = [&]() {" << '\n';
+    header_file << "\t\tfor (size_t i = next_file++; i < file_names.size(); i = next_file++) {" << '\n';
+    header_file << "\t\t\t" << result_name << template_arguments << "& result = results[i];" << '\n';
+    header_file << "\t\t\tresult.file_name = file_names[i];" << '\n';
+    header_file << "#ifdef __cpp_exceptions" << '\n';
+    header_file << "\t\t\ttry {" << '\n';
+    header_file << "#endif" << '\n';
+    header_file << "\t\t\t\tresult.lexer = std::make_unique<Lexer>(file_names[i]);" << '\n';
+
+    if (events) {
+        header_file << "\t\t\t\tresult.handler = std::make_unique<Handler>();" << '\n';
+        header_file << "\t\t\t\tresult.parser = std::make_unique<" << parser_class_name() << "<ParserLexer>>(*result.lexer, *result.handler);" << '\n';
+    } else {
+        header_file << "\t\t\t\tresult.parser = std::make_unique<" << parser_class_name() << "<ParserLexer>>(*result.lexer);" << '\n';
+    }
+
+    header_file << "\t\t\t\tresult.parser->start_parsing();" << '\n';
+    header_file << "#ifdef __cpp_exceptions" << '\n';
+    header_file << "\t\t\t} catch (const std::exception& exception) {" << '\n';
+    header_file << "\t\t\t\tresult.error = exception.what();" << '\n';
+    header_file << "\t\t\t}" << '\n';
+    header_file << "#endif" << '\n';
+    header_file << "\t\t}" << '\n';
+    header_file << "\t};" << "\n\n";
+    header_file << "\t// The calling thread works too, so one thread needs no others" << '\n';
+    header_file << "\tstd::vector<std::thread> threads;" << '\n';
+    header_file << "\tfor (size_t i = 1; i < thread_count && i < file_names.size(); i++) {" << '\n';
+    header_file << "#ifdef __cpp_exceptions" << '\n';
+    header_file << "\t\ttry {" << '\n';
+    header_file << "#endif" << '\n';
+    header_file << "\t\t\tthreads.emplace_back(parse_next_files);" << '\n';
+    header_file << "#ifdef __cpp_exceptions" << '\n';
+    header_file << "\t\t} catch (const std::exception&) {" << '\n';
+    header_file << "\t\t\t// No more threads can be started, so the files left are shared by those already running and this one" << '\n';
+    header_file << "\t\t\tbreak;" << '\n';
+    header_file << "\t\t}" << '\n';
+    header_file << "#endif" << '\n';
+    header_file << "\t}" << '\n';
+    header_file << "\tparse_next_files();" << '\n';
+    header_file << "\tfor (std::thread& thread : threads) {" << '\n';
+    header_file << "\t\tthread.join();" << '\n';
+    header_file << "\t}" << "\n\n";
+    header_file << "\treturn results;" << '\n';
+    header_file << "}" << "\n\n";
+}
+
+bool Generator::build_lexer_dfa(Grammar& grammar, const GeneratorOptions& options, LexerDFA& dfa) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    int numeric_constant_id = symbol_table.get_terminal_id("numeric_constant");
+    int string_literal_id = symbol_table.get_terminal_id("string_literal");
+    int identifier_id = symbol_table.get_terminal_id("identifier");
+
+    dfa.clear();
+
+    // Comments are added first, so a comment delimiter which is also a terminal starts a comment
+    if (options.line_comment != "") {
+        dfa.add_literal(options.line_comment, DFA_LINE_COMMENT);
+    }
+
+    if (options.block_comment_start != "") {
+        if (options.block_comment_end == "") {
+            spdlog::error("Block comments need an end as well as a start");
+            return false;
+        }
+
+        dfa.add_literal(options.block_comment_start, DFA_BLOCK_COMMENT);
+    }
+
+    // Terminals go before identifiers so keywords are not lexed as identifiers
+    for (int id = 0; id < symbol_table.get_terminal_count(); id++) {
+        if (id == SymbolTable::EPSILON_ID || id == SymbolTable::EOF_ID || id == numeric_constant_id || id == string_literal_id || id == identifier_id) {
+            continue;
+        }
+
+        dfa.add_literal(symbol_table.get_terminal_name(id), id);
+    }
+
+    if (identifier_id != -1) {
+        dfa.add_identifier(identifier_id);
+    }
+
+    dfa.add_number(numeric_constant_id);
+    dfa.add_string(string_literal_id);
+    dfa.add_whitespace(DFA_SKIP);
+    dfa.build();
+
+    return true;
+}
+
+bool Generator::generate_lexer_tables(std::ostream& code_file) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+    int numeric_constant_id = symbol_table.get_terminal_id("numeric_constant");
+    int string_literal_id = symbol_table.get_terminal_id("string_literal");
+    int identifier_id = symbol_table.get_terminal_id("identifier");
+    LexerDFA dfa;
+
+    if (!build_lexer_dfa(grammar, options, dfa)) {
+        return false;
+    }
+
+    COMP3931_DEBUG("Lexer automaton has {} states and {} character classes", dfa.get_state_count(), dfa.get_class_count());
+
+    std::string state_type = dfa.get_state_count() <= 256 ? "uint8_t" : dfa.get_state_count() <= 65536 ? "uint16_t" : "uint32_t";
+
+    code_file << "// Lexer automaton. Bytes which it never tells apart share a class, and each state has a row of DFA_CLASS_COUNT" << '\n';
+    code_file << "// transitions, one for each class" << '\n';
+    code_file << "typedef " << state_type << " DFAState;" << '\n';
+    code_file << "static const DFAState DFA_DEAD_STATE = " << LexerDFA::DEAD_STATE << ";" << '\n';
+    code_file << "static const DFAState DFA_START_STATE = " << LexerDFA::START_STATE << ";" << '\n';
+    code_file << "static const int DFA_CLASS_COUNT = " << dfa.get_class_count() << ";" << "\n\n";
+
+    code_file << "// Accepted by states which end something other than a token" << '\n';
+    code_file << "static const int DFA_NO_ACCEPT = " << LexerDFA::NO_ACCEPT << ";" << '\n';
+    code_file << "static const int DFA_SKIP = " << DFA_SKIP << ";" << '\n';
+    code_file << "static const int DFA_LINE_COMMENT = " << DFA_LINE_COMMENT << ";" << '\n';
+    code_file << "static const int DFA_BLOCK_COMMENT = " << DFA_BLOCK_COMMENT << ";" << '\n';
+    code_file << "static const std::string_view dfa_block_comment_end = \"" << escape_string(options.block_comment_end) << "\";" << "\n\n";
+
+    code_file << "static const uint8_t dfa_char_classes[256] = {" << '\n';
+
+    for (int c = 0; c < 256; c++) {
+        code_file << (c % 16 == 0 ? "\t" : " ") << dfa.get_char_class(c) << ",";
+
+        if (c % 16 == 15) {
+            code_file << '\n';
+        }
+    }
+
+    code_file << "};" << "\n\n";
+
+    code_file << "static const DFAState dfa_transitions[] = {" << '\n';
+
+    for (int state = 0; state < dfa.get_state_count(); state++) {
+        code_file << "\t";
+
+        for (int char_class = 0; char_class < dfa.get_class_count(); char_class++) {
+            code_file << dfa.get_transition(state, char_class) << ", ";
+        }
+
+        code_file << "\t// " << state << '\n';
+    }
+
+    code_file << "};" << "\n\n";
+
+    code_file << "// TokenKind ended by each state" << '\n';
+    code_file << "static const int dfa_accepts[] = {" << '\n';
+
+    for (int state = 0; state < dfa.get_state_count(); state++) {
+        int accept = dfa.get_accept(state);
+
+        switch (accept) {
+            case LexerDFA::NO_ACCEPT: code_file << "\tDFA_NO_ACCEPT," << '\n'; break;
+            case DFA_SKIP: code_file << "\tDFA_SKIP," << '\n'; break;
+            case DFA_LINE_COMMENT: code_file << "\tDFA_LINE_COMMENT," << '\n'; break;
+            case DFA_BLOCK_COMMENT: code_file << "\tDFA_BLOCK_COMMENT," << '\n'; break;
+            default: code_file << "\t" << token_kind_names[accept] << "," << '\n';
+        }
+    }
+
+    code_file << "};" << "\n\n";
+
+    // The same token types as classify_token() expects
+    code_file << "static std::string_view dfa_token_type(TokenKind kind) {" << '\n';
+
+    if (identifier_id != -1) {
+        code_file << "\tif (kind == " << token_kind_names[identifier_id] << ") {" << '\n';
+        code_file << "\t\treturn \"IDENTIFIER\";" << '\n';
+        code_file << "\t}" << '\n';
+    }
+
+    code_file << "\tif (kind == " << token_kind_names[numeric_constant_id] << ") {" << '\n';
+    code_file << "\t\treturn \"NUMERIC_CONSTANT\";" << '\n';
+    code_file << "\t}" << '\n';
+    code_file << "\tif (kind == " << token_kind_names[string_literal_id] << ") {" << '\n';
+    code_file << "\t\treturn \"STRING_LITERAL\";" << '\n';
+    code_file << "\t}" << '\n';
+    code_file << "\treturn kind == TK_UNKNOWN ? \"UNKNOWN\" : \"TERMINAL\";" << '\n';
+    code_file << "}" << "\n\n";
+
+    return true;
+}
+
+void Generator::generate_reparse_functions(std::ostream& code_file) {
+    SymbolTable& symbol_table = grammar.get_symbol_table();
+
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "size_t " << parser_class_name() << "<Lexer>::" << source_reparse_function << "\n\n";
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "void " << parser_class_name() << "<Lexer>::" << source_collect_reusable_nodes_function << "\n\n";
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "bool " << parser_class_name() << "<Lexer>::" << source_reuse_subtree_function << "\n\n";
+
+    // Call the parse function of a nonterminal kind
+    code_file << "template <typename Lexer>" << '\n';
+    code_file << "void " << parser_class_name() << "<Lexer>::parse_nonterminal(int kind, ParseTreeNode* parse_tree_parent) {" << '\n';
+    code_file << "\tswitch (kind) {" << '\n';
+
+    for (int nonterminal_id = 0; nonterminal_id < symbol_table.get_nonterminal_count(); nonterminal_id++) {
+        code_file << "\t\tcase " << nonterminal_kind_names[nonterminal_id] << ":" << '\n';
+        code_file << "\t\t\tparse_" << symbol_table.get_nonterminal_name(nonterminal_id) << "(parse_tree_parent);" << '\n';
+        code_file << "\t\t\tbreak;" << '\n';
+    }
+
+    code_file << "\t}" << '\n';
+    code_file << "}" << "\n\n";
+}
+
+void Generator::generate_lookahead_sets(std::ostream& code_file) {
+    GrammarIR& ir = grammar.get_ir();
+    // Room for every kind including TK_UNKNOWN, which is never in a set
+    int word_count = grammar.get_symbol_table().get_terminal_count() / 64 + 1;
+
+    for (int node_index = 0; node_index < ir.get_node_count(); node_index++) {
+        const GrammarIR::Node& node = ir.get_node(node_index);
+
+        if (node.type != EBNFToken::TokenType::REPEAT && node.type != EBNFToken::TokenType::OPTIONAL) {
+            continue;
+        }
+
+        SymbolSet first_set = ir.get_first_set(node.first_child);
+        first_set.erase(SymbolTable::EPSILON_ID);
+
+        // Sets of one kind are tested with ==
+        if (first_set.size() <= 1) {
+            continue;
+        }
+
+        code_file << "// First(`" << escape_string(ir.to_string(node.first_child, grammar.get_symbol_table())) << "`)" << '\n';
+        code_file << "static const uint64_t lookahead_" << node_index << "[] = {" << bitmask_words(first_set, word_count) << "};" << '\n';
+    }
+
+    code_file << '\n';
+}
+
+std::string Generator::lookahead_condition(int node_index, const SymbolSet& first_set) {
+    SymbolSet lookahead = first_set;
+    lookahead.erase(SymbolTable::EPSILON_ID);
+
+    if (lookahead.size() == 1) {
+        return "next_token->get_kind() == " + token_kind_names[lookahead.next(0)];
+    }
+
+    return "token_in_set(lookahead_" + std::to_string(node_index) + ", next_token->get_kind())";
+}
+
+std::string Generator::escape_string(const std::string& value) {
+    std::string escaped;
+
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+std::string Generator::character_name(char c) {
+    switch (c) {
+        case '(': return "LPAREN";
+        case ')': return "RPAREN";
+        case '[': return "LBRACKET";
+        case ']': return "RBRACKET";
+        case '{': return "LBRACE";
+        case '}': return "RBRACE";
+        case '<': return "LESS";
+        case '>': return "GREATER";
+        case '=': return "EQUALS";
+        case '+': return "PLUS";
+        case '-': return "MINUS";
+        case '*': return "STAR";
+        case '/': return "SLASH";
+        case '%': return "PERCENT";
+        case '&': return "AMPERSAND";
+        case '|': return "PIPE";
+        case '~': return "TILDE";
+        case '!': return "BANG";
+        case '^': return "CARET";
+        case '?': return "QUESTION";
+        case ':': return "COLON";
+        case ';': return "SEMICOLON";
+        case ',': return "COMMA";
+        case '.': return "DOT";
+        case '#': return "HASH";
+        case '@': return "AT";
+        case '$': return "DOLLAR";
+        case '\'': return "QUOTE";
+        case '"': return "DOUBLE_QUOTE";
+        case '`': return "BACKTICK";
+        case '\\': return "BACKSLASH";
+        default: {
+            char name[8];
+            snprintf(name, sizeof(name), "X%02X", static_cast<unsigned char>(c));
+            return name;
+        }
+    }
+}
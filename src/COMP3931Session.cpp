@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "COMP3931Session.hpp"
+#include "COMP3931Grammar.hpp"
+#include "COMP3931ParserGenerator.hpp"
+#include "spdlog/spdlog.h"
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/sinks/base_sink.h"
+
+using namespace ParserGenerator;
+
+namespace {
+    // Keeps the warnings and errors logged to it, and passes every message on to the logger which was the default
+    class DiagnosticSink : public spdlog::sinks::base_sink<spdlog::details::null_mutex> {
+    public:
+        DiagnosticSink(std::shared_ptr<spdlog::logger> forward_logger, std::vector<Diagnostic>& diagnostics) : forward_logger(forward_logger), diagnostics(diagnostics) {
+
+        }
+
+    protected:
+        void sink_it_(const spdlog::details::log_msg& msg) override {
+            if (msg.level >= spdlog::level::warn && msg.level != spdlog::level::off) {
+                Diagnostic::Severity severity = msg.level == spdlog::level::warn ? Diagnostic::WARNING : Diagnostic::ERROR;
+                diagnostics.push_back({severity, std::string(msg.payload.data(), msg.payload.size())});
+            }
+
+            if (forward_logger != nullptr && forward_logger->should_log(msg.level)) {
+                forward_logger->log(msg.time, msg.source, msg.level, msg.payload);
+            }
+        }
+
+        void flush_() override {
+            if (forward_logger != nullptr) {
+                forward_logger->flush();
+            }
+        }
+
+    private:
+        std::shared_ptr<spdlog::logger> forward_logger;
+        std::vector<Diagnostic>& diagnostics;
+    };
+
+    // Held by every DiagnosticCapture, as the default logger is shared by the whole process
+    std::mutex step_mutex;
+
+    // Collects the diagnostics of one Session step into its result, by making a logger with a DiagnosticSink the
+    // default for as long as it exists. Only one exists at a time, so steps on other threads wait for it
+    class DiagnosticCapture {
+    public:
+        DiagnosticCapture(Result& result) : lock(step_mutex), result(result), previous_logger(spdlog::default_logger()) {
+            spdlog::level::level_enum level = spdlog::level::warn;
+
+            // Warnings and errors are always collected, even if the previous logger leaves them out
+            if (previous_logger != nullptr) {
+                level = std::min(level, previous_logger->level());
+            }
+
+            std::shared_ptr<spdlog::logger> capture_logger = std::make_shared<spdlog::logger>("", std::make_shared<DiagnosticSink>(previous_logger, result.diagnostics));
+            capture_logger->set_level(level);
+            spdlog::set_default_logger(capture_logger);
+        }
+
+        ~DiagnosticCapture() {
+            spdlog::set_default_logger(previous_logger);
+        }
+
+        DiagnosticCapture(const DiagnosticCapture&) = delete;
+        DiagnosticCapture& operator=(const DiagnosticCapture&) = delete;
+
+        void finish(bool step_succeeded) {
+            result.succeeded = step_succeeded && result.get_error_count() == 0;
+        }
+
+    private:
+        // Taken first and released last, around the swaps of the default logger
+        std::lock_guard<std::mutex> lock;
+        Result& result;
+        std::shared_ptr<spdlog::logger> previous_logger;
+    };
+} // namespace
+
+/*
+ * Result Struct
+ */
+
+int Result::get_error_count() const {
+    return std::count_if(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& diagnostic) { return diagnostic.severity == Diagnostic::ERROR; });
+}
+
+int Result::get_warning_count() const {
+    return std::count_if(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& diagnostic) { return diagnostic.severity == Diagnostic::WARNING; });
+}
+
+/*
+ * Session Class
+ */
+
+Session::Session() {
+
+}
+
+Session::~Session() {
+
+}
+
+Result Session::load_file(const std::string& file_path) {
+    Result result;
+    DiagnosticCapture capture(result);
+
+    grammar = std::make_unique<Grammar>();
+    capture.finish(grammar->input_language_from_file(file_path));
+
+    return result;
+}
+
+Result Session::load_string(std::string_view contents) {
+    Result result;
+    DiagnosticCapture capture(result);
+
+    grammar = std::make_unique<Grammar>();
+    capture.finish(grammar->input_language_from_string(contents));
+
+    return result;
+}
+
+Result Session::load_finalized_file(const std::string& file_path, bool use_cache) {
+    Result result;
+    DiagnosticCapture capture(result);
+
+    grammar = std::make_unique<Grammar>();
+    capture.finish(grammar->input_finalized_language(file_path, use_cache));
+
+    return result;
+}
+
+Result Session::finalize() {
+    Result result;
+    DiagnosticCapture capture(result);
+
+    capture.finish(check_loaded("finalize") && finalize_if_needed());
+
+    return result;
+}
+
+Result Session::validate(const GeneratorOptions& options) {
+    Result result;
+    DiagnosticCapture capture(result);
+
+    capture.finish(check_loaded("validate") && finalize_if_needed() && Generator::validate(*grammar, options));
+
+    return result;
+}
+
+Result Session::generate(const std::string& name, const GeneratorOptions& options, OutputSink* sink) {
+    Result result;
+    DiagnosticCapture capture(result);
+
+    if (!check_loaded("generate from") || !finalize_if_needed()) {
+        capture.finish(false);
+        return result;
+    }
+
+    Generator generator(*grammar, name, options, sink);
+    capture.finish(generator.get_succeeded());
+
+    return result;
+}
+
+bool Session::has_grammar() { return grammar != nullptr; }
+
+Grammar& Session::get_grammar() { return *grammar; }
+
+bool Session::check_loaded(const char* step) {
+    if (grammar == nullptr) {
+        spdlog::error("Cannot {} a grammar before one is loaded", step);
+        return false;
+    }
+
+    return true;
+}
+
+bool Session::finalize_if_needed() {
+    return grammar->get_is_final() || grammar->finalize_grammar();
+}
@@ -0,0 +1,214 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "COMP3931SymbolSet.hpp"
+
+using namespace ParserGenerator;
+
+namespace {
+    const int WORD_BITS = 64;
+
+    int words_for_width(int width) {
+        return (width + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    int count_trailing_zeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#else
+        int count = 0;
+        while ((word & 1) == 0) {
+            word >>= 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    int count_bits(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(word);
+#else
+        int count = 0;
+        while (word != 0) {
+            word &= word - 1;
+            count++;
+        }
+        return count;
+#endif
+    }
+} // namespace
+
+/*
+ * SymbolSet Class
+ */
+
+SymbolSet::SymbolSet() : width(0) {
+
+}
+
+SymbolSet::SymbolSet(int width) : width(width), words(words_for_width(width), 0) {
+
+}
+
+SymbolSet::SymbolSet(int width, const uint64_t* words) : width(width), words(words, words + words_for_width(width)) {
+
+}
+
+int SymbolSet::get_width() const { return width; }
+
+bool SymbolSet::insert(int symbol_id) {
+    if (symbol_id >= width) {
+        grow(symbol_id + 1);
+    }
+
+    uint64_t mask = uint64_t(1) << (symbol_id % WORD_BITS);
+    uint64_t& word = words[symbol_id / WORD_BITS];
+
+    if ((word & mask) != 0) {
+        return false;
+    }
+
+    word |= mask;
+    return true;
+}
+
+void SymbolSet::erase(int symbol_id) {
+    if (symbol_id < 0 || symbol_id >= width) {
+        return;
+    }
+
+    words[symbol_id / WORD_BITS] &= ~(uint64_t(1) << (symbol_id % WORD_BITS));
+}
+
+bool SymbolSet::contains(int symbol_id) const {
+    if (symbol_id < 0 || symbol_id >= width) {
+        return false;
+    }
+
+    return (words[symbol_id / WORD_BITS] >> (symbol_id % WORD_BITS)) & 1;
+}
+
+bool SymbolSet::unite(const SymbolSet& other) {
+    if (other.width > width) {
+        grow(other.width);
+    }
+
+    // Accumulate the new bits instead of branching on each word so the loop can be vectorised
+    uint64_t new_bits = 0;
+
+    for (size_t i = 0; i < other.words.size(); i++) {
+        new_bits |= other.words[i] & ~words[i];
+        words[i] |= other.words[i];
+    }
+
+    return new_bits != 0;
+}
+
+bool SymbolSet::intersects(const SymbolSet& other) const {
+    return first_common(other) != -1;
+}
+
+int SymbolSet::first_common(const SymbolSet& other) const {
+    size_t word_count = words.size() < other.words.size() ? words.size() : other.words.size();
+
+    for (size_t i = 0; i < word_count; i++) {
+        uint64_t common = words[i] & other.words[i];
+
+        if (common != 0) {
+            return static_cast<int>(i) * WORD_BITS + count_trailing_zeros(common);
+        }
+    }
+
+    return -1;
+}
+
+bool SymbolSet::empty() const {
+    for (uint64_t word : words) {
+        if (word != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int SymbolSet::size() const {
+    int count = 0;
+
+    for (uint64_t word : words) {
+        count += count_bits(word);
+    }
+
+    return count;
+}
+
+void SymbolSet::clear() {
+    for (uint64_t& word : words) {
+        word = 0;
+    }
+}
+
+int SymbolSet::next(int from) const {
+    if (from < 0) {
+        from = 0;
+    }
+
+    if (from >= width) {
+        return -1;
+    }
+
+    size_t i = from / WORD_BITS;
+    uint64_t word = words[i] & (~uint64_t(0) << (from % WORD_BITS));
+
+    while (true) {
+        if (word != 0) {
+            return static_cast<int>(i) * WORD_BITS + count_trailing_zeros(word);
+        }
+
+        i++;
+
+        if (i >= words.size()) {
+            return -1;
+        }
+
+        word = words[i];
+    }
+}
+
+std::vector<int> SymbolSet::to_vector() const {
+    std::vector<int> symbol_ids;
+
+    for (int id = next(0); id != -1; id = next(id + 1)) {
+        symbol_ids.push_back(id);
+    }
+
+    return symbol_ids;
+}
+
+const std::vector<uint64_t>& SymbolSet::get_words() const { return words; }
+
+bool SymbolSet::operator==(const SymbolSet& other) const {
+    const std::vector<uint64_t>& shorter = words.size() < other.words.size() ? words : other.words;
+    const std::vector<uint64_t>& longer = words.size() < other.words.size() ? other.words : words;
+
+    for (size_t i = 0; i < longer.size(); i++) {
+        uint64_t short_word = i < shorter.size() ? shorter[i] : 0;
+
+        if (short_word != longer[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SymbolSet::operator!=(const SymbolSet& other) const {
+    return !(*this == other);
+}
+
+void SymbolSet::grow(int new_width) {
+    width = new_width;
+    words.resize(words_for_width(new_width), 0);
+}
@@ -0,0 +1,77 @@
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "COMP3931SymbolTable.hpp"
+
+using namespace ParserGenerator;
+
+/*
+ * SymbolTable Class
+ */
+
+const int SymbolTable::EPSILON_ID;
+const int SymbolTable::EOF_ID;
+
+SymbolTable::SymbolTable() {
+    // The order here must match EPSILON_ID and EOF_ID
+    add_terminal("epsilon");
+    add_terminal("eof");
+}
+
+int SymbolTable::add_terminal(const std::string& name) {
+    int existing_id = get_terminal_id(name);
+
+    if (existing_id != -1) {
+        return existing_id;
+    }
+
+    int new_id = static_cast<int>(terminal_names.size());
+    terminal_names.push_back(name);
+    terminal_ids.insert({terminal_names.back(), new_id});
+
+    return new_id;
+}
+
+int SymbolTable::add_nonterminal(const std::string& name) {
+    int existing_id = get_nonterminal_id(name);
+
+    if (existing_id != -1) {
+        return existing_id;
+    }
+
+    int new_id = static_cast<int>(nonterminal_names.size());
+    nonterminal_names.push_back(name);
+    nonterminal_ids.insert({nonterminal_names.back(), new_id});
+
+    return new_id;
+}
+
+int SymbolTable::get_terminal_id(std::string_view name) const {
+    std::unordered_map<std::string_view, int>::const_iterator it = terminal_ids.find(name);
+
+    if (it == terminal_ids.end()) {
+        return -1;
+    }
+
+    return it->second;
+}
+
+int SymbolTable::get_nonterminal_id(std::string_view name) const {
+    std::unordered_map<std::string_view, int>::const_iterator it = nonterminal_ids.find(name);
+
+    if (it == nonterminal_ids.end()) {
+        return -1;
+    }
+
+    return it->second;
+}
+
+const std::string& SymbolTable::get_terminal_name(int id) const { return terminal_names[id]; }
+
+const std::string& SymbolTable::get_nonterminal_name(int id) const { return nonterminal_names[id]; }
+
+int SymbolTable::get_terminal_count() const { return static_cast<int>(terminal_names.size()); }
+
+int SymbolTable::get_nonterminal_count() const { return static_cast<int>(nonterminal_names.size()); }
@@ -1,49 +1,260 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 #include <vector>
 
-#include "COMP3931Grammar.hpp"
+#include "COMP3931InputBuffer.hpp"
+#include "COMP3931Interpreter.hpp"
+#include "COMP3931Logging.hpp"
 #include "COMP3931ParserGenerator.hpp"
+#include "COMP3931Session.hpp"
 #include "spdlog/spdlog.h"
+#include "spdlog/async.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/basic_file_sink.h"
 
+namespace {
+    // Size of the ring buffer used by --async-log, in log messages
+    const size_t async_log_queue_size = 8192;
+
+    bool parse_log_level(const std::string& name, spdlog::level::level_enum& level) {
+        const std::vector<std::string> level_names = {"trace", "debug", "info", "warn", "error", "critical", "off"};
+
+        for (size_t i = 0; i < level_names.size(); i++) {
+            if (level_names[i] == name) {
+                level = static_cast<spdlog::level::level_enum>(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Counts what the interpreter recognises without keeping any of it
+    class CountingEventHandler : public ParserGenerator::InterpreterEventHandler {
+    public:
+        size_t nonterminal_count = 0;
+
+        void enter(int) {
+            nonterminal_count++;
+        }
+
+        void token(int, std::string_view) {
+
+        }
+
+        void exit(int) {
+
+        }
+    };
+
+    // Lex and parse each file with the grammar, repeat times, reporting syntax errors and the speed. True if every file parsed
+    bool interpret_files(ParserGenerator::Grammar& grammar, const ParserGenerator::GeneratorOptions& options, const std::vector<std::string>& file_names, int repeat) {
+        ParserGenerator::Interpreter interpreter(grammar, options);
+        ParserGenerator::InterpretedTree tree;
+        CountingEventHandler handler;
+        std::vector<ParserGenerator::InterpreterToken> tokens;
+        std::chrono::steady_clock::duration lex_time(0);
+        std::chrono::steady_clock::duration parse_time(0);
+        size_t token_count = 0;
+        int failed_files = 0;
+
+        for (const std::string& file_name : file_names) {
+            ParserGenerator::InputBuffer input;
+
+            if (!input.open_file(file_name)) {
+                spdlog::error("Cannot open input file: {}", file_name);
+                failed_files++;
+                continue;
+            }
+
+            for (int i = 0; i < repeat; i++) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+                tokens.clear();
+                if (!interpreter.lex(input.get_contents(), tokens)) {
+                    return false;
+                }
+
+                std::chrono::steady_clock::time_point lexed = std::chrono::steady_clock::now();
+                ParserGenerator::TokenVector lexer(tokens);
+                bool parsed = options.tree_type == ParserGenerator::GeneratorOptions::EVENTS ? interpreter.parse(lexer, handler) : interpreter.parse(lexer, tree);
+
+                parse_time += std::chrono::steady_clock::now() - lexed;
+                lex_time += lexed - start;
+                token_count += tokens.size();
+
+                if (!parsed) {
+                    spdlog::error("`{}` {}", file_name, interpreter.get_error());
+                    failed_files++;
+                    break;
+                }
+            }
+        }
+
+        double lex_seconds = std::chrono::duration<double>(lex_time).count();
+        double parse_seconds = std::chrono::duration<double>(parse_time).count();
+
+        spdlog::info("Interpreted {} of {} files without errors, {} times each", file_names.size() - failed_files, file_names.size(), repeat);
+        spdlog::info("{} tokens lexed in {:.2f} ms ({:.0f} tokens/second) and parsed in {:.2f} ms ({:.0f} tokens/second)", token_count, lex_seconds * 1000, lex_seconds > 0 ? token_count / lex_seconds : 0, parse_seconds * 1000, parse_seconds > 0 ? token_count / parse_seconds : 0);
+
+        return failed_files == 0;
+    }
+
+    void print_usage(const char* program_name) {
+        spdlog::info("Correct usage: {} [options] [input file name] [output file name]", program_name);
+        spdlog::info("         or: {} [options] --interpret [input file name] [files to parse...]", program_name);
+        spdlog::info("Options:");
+        spdlog::info("  --log-level <level>  One of trace, debug, info, warn, error, critical, off (default info)");
+        spdlog::info("  --log-file <path>    Also write the log to a file");
+        spdlog::info("  --async-log          Write the log file from a background thread through a ring buffer");
+        spdlog::info("  --no-grammar-cache   Always parse and finalize the grammar, without reading or writing its .cache file");
+        spdlog::info("  --stdout             Print the generated files instead of writing them, and log to stderr");
+        spdlog::info("  --flat-tree          Build the parse tree as parallel arrays in preorder instead of linked nodes");
+        spdlog::info("  --events             Call a ParseEventHandler as the input is parsed instead of building a tree");
+        spdlog::info("  --table              Generate a table driven parser instead of recursive descent");
+        spdlog::info("  --recover            Record syntax errors and carry on parsing instead of throwing exceptions");
+        spdlog::info("  --lexer-class <name> Also compile the parser for this lexer class, so its calls can be inlined");
+        spdlog::info("  --lexer-header <path> Header declaring a --lexer-class, included by the generated source");
+        spdlog::info("  --lexer              Also generate DFALexer, a table driven lexer for the grammar's terminals");
+        spdlog::info("  --line-comment <start> Make DFALexer skip from this to the end of the line");
+        spdlog::info("  --block-comment <start> <end> Make DFALexer skip from start to the next end");
+        spdlog::info("  --incremental        Let the parser reparse only the subtrees an edit of the tokens touched");
+        spdlog::info("  --interpret          Parse files with the grammar directly instead of generating a parser, reporting errors and speed");
+        spdlog::info("  --repeat <n>         With --interpret, lex and parse each file n times (default 1)");
+    }
+} // namespace
+
 int main(int argc, char const* argv[]) {
-    // Create a logger to stdout and  a logger to a text file
-    auto stdout_sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
-    // stdout_sink->set_level(spdlog::level::warn);
-    stdout_sink->set_level(spdlog::level::info);
+    spdlog::level::level_enum log_level = spdlog::level::info;
+    std::string log_file_name = "";
+    bool async_log = false;
+    bool use_grammar_cache = true;
+    bool write_to_stdout = false;
+    bool interpret = false;
+    int repeat = 1;
+    ParserGenerator::GeneratorOptions generator_options;
+    std::vector<std::string> positional_args;
 
-    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_st>("output.log");
-    file_sink->set_level(spdlog::level::trace);
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--log-level" && i + 1 < argc) {
+            if (!parse_log_level(argv[++i], log_level)) {
+                spdlog::error("Unknown log level `{}`", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--log-file" && i + 1 < argc) {
+            log_file_name = argv[++i];
+        } else if (arg == "--async-log") {
+            async_log = true;
+        } else if (arg == "--flat-tree") {
+            generator_options.tree_type = ParserGenerator::GeneratorOptions::FLAT_TREE;
+        } else if (arg == "--events") {
+            generator_options.tree_type = ParserGenerator::GeneratorOptions::EVENTS;
+        } else if (arg == "--table") {
+            generator_options.backend = ParserGenerator::GeneratorOptions::TABLE;
+        } else if (arg == "--recover") {
+            generator_options.error_recovery = true;
+        } else if (arg == "--lexer-class" && i + 1 < argc) {
+            generator_options.lexer_classes.push_back(argv[++i]);
+        } else if (arg == "--lexer-header" && i + 1 < argc) {
+            generator_options.lexer_headers.push_back(argv[++i]);
+        } else if (arg == "--lexer") {
+            generator_options.generate_lexer = true;
+        } else if (arg == "--line-comment" && i + 1 < argc) {
+            generator_options.line_comment = argv[++i];
+        } else if (arg == "--block-comment" && i + 2 < argc) {
+            generator_options.block_comment_start = argv[++i];
+            generator_options.block_comment_end = argv[++i];
+        } else if (arg == "--stdout") {
+            write_to_stdout = true;
+        } else if (arg == "--no-grammar-cache") {
+            use_grammar_cache = false;
+        } else if (arg == "--incremental") {
+            generator_options.incremental = true;
+        } else if (arg == "--interpret") {
+            interpret = true;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            spdlog::error("Unknown option `{}`", arg);
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            positional_args.push_back(arg);
+        }
+    }
 
-    spdlog::sinks_init_list sink_list = {file_sink, stdout_sink};
+    // Create a logger to stdout, or stderr when the generated code goes to stdout, and optionally a logger to a text file
+    std::vector<spdlog::sink_ptr> sinks;
 
-    spdlog::set_default_logger(std::make_shared<spdlog::logger>("", sink_list.begin(), sink_list.end()));
-    spdlog::set_level(spdlog::level::trace);
+    if (async_log) {
+        // The async logger is shared with the background thread so every sink must be thread safe
+        if (write_to_stdout) {
+            sinks.push_back(std::make_shared<spdlog::sinks::stderr_color_sink_mt>());
+        } else {
+            sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+        }
 
-    spdlog::trace("Setup complete");
+        if (log_file_name != "") {
+            sinks.push_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>(log_file_name));
+        }
 
-    if (argc != 3) {
+        spdlog::init_thread_pool(async_log_queue_size, 1);
+        spdlog::set_default_logger(std::make_shared<spdlog::async_logger>("", sinks.begin(), sinks.end(), spdlog::thread_pool(), spdlog::async_overflow_policy::block));
+    } else {
+        if (write_to_stdout) {
+            sinks.push_back(std::make_shared<spdlog::sinks::stderr_color_sink_st>());
+        } else {
+            sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_st>());
+        }
+
+        if (log_file_name != "") {
+            sinks.push_back(std::make_shared<spdlog::sinks::basic_file_sink_st>(log_file_name));
+        }
+
+        spdlog::set_default_logger(std::make_shared<spdlog::logger>("", sinks.begin(), sinks.end()));
+    }
+
+    spdlog::set_level(log_level);
+
+    COMP3931_TRACE("Setup complete");
+
+    if (interpret ? positional_args.size() < 2 : positional_args.size() != 2) {
         spdlog::error("Invalid number of parameters");
-        spdlog::info("Correct usage: {} [input file name] [output file name]", argv[0]);
+        print_usage(argv[0]);
+        spdlog::shutdown();
         return 1;
     }
 
-    ParserGenerator::Grammar grammar;
-    grammar.input_language_from_file(argv[1]);
+    // The diagnostics in each result have already been logged, so only whether the step succeeded is used here
+    ParserGenerator::Session session;
+    ParserGenerator::Result result = session.load_finalized_file(positional_args[0], use_grammar_cache);
 
-    grammar.finalize_grammar();
-    grammar.log_grammar();
+    if (result.succeeded && interpret) {
+        // The inputs are parsed like a table driven parser with the options' tree type would parse them
+        result = session.validate(generator_options);
 
-    spdlog::info("Generating parser");
+        if (result.succeeded) {
+            std::vector<std::string> file_names(positional_args.begin() + 1, positional_args.end());
+            result.succeeded = interpret_files(session.get_grammar(), generator_options, file_names, repeat);
+        }
+    } else if (result.succeeded) {
+        session.get_grammar().log_grammar();
 
-    ParserGenerator::Generator pg(grammar, argv[2]);
+        spdlog::info("Generating parser");
+
+        // The output file name still names the generated files and classes when they are printed
+        ParserGenerator::StreamSink stdout_sink;
+        result = session.generate(positional_args[1], generator_options, write_to_stdout ? &stdout_sink : nullptr);
+    }
 
-    // spdlog::warn("Easy padding in numbers like {:08d}", 12);
-    // spdlog::critical("Support for int: {0:d};  hex: {0:x};  oct: {0:o}; bin: {0:b}", 42);
-    // spdlog::info("Support for floats {:03.2f}", 1.23456);
-    // spdlog::info("Positional args are {1} {0}..", "too", "supported");
-    // spdlog::info("{:>8} aligned, {:<8} aligned", "right", "left");
+    // Flush and stop the async logging thread, if there is one
+    spdlog::shutdown();
 
-    return 0;
+    return result.succeeded ? 0 : 1;
 }
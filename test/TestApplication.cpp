@@ -1,215 +1,178 @@
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "TestApplication.hpp"
 #include "JACKCompiler.hpp"
 
-// Declare all of the keyword lists
-const std::vector<std::string> CustomJACKLexer::constructKeywords = {"class", "constructor", "method", "function"};
-const std::vector<std::string> CustomJACKLexer::typeKeywords = {"int", "boolean", "char", "void"};
-const std::vector<std::string> CustomJACKLexer::variableKeywords = {"var", "let", "static", "field"};
-const std::vector<std::string> CustomJACKLexer::controlKeywords = {"do", "if", "else", "while", "return"};
-const std::vector<std::string> CustomJACKLexer::referenceKeywords = {"this"};
-const std::vector<std::string> CustomJACKLexer::valueKeywords = {"true", "false", "null"};
+using namespace GeneratedParser;
 
-CustomJACKLexer::CustomJACKLexer(std::string file_name) : file_name(file_name), token_list_head(nullptr), token_list_tail(nullptr), next_token(nullptr) {
-    scan_file();
-}
+const size_t CustomJACKLexer::STREAM_BUFFER_SIZE;
 
-CustomJACKLexer::~CustomJACKLexer() {
-    // Destroy list of tokens
-    if (token_list_head != nullptr) {
-        CustomLexerToken* token = token_list_head;
-        CustomLexerToken* next_token = token_list_head->next;
-        while (token != nullptr) {
-            // std::cout << "KILL: " << token->get_lexeme() << std::endl;
-            delete token;
-            token = next_token;
-            if (next_token != nullptr) {
-                next_token = next_token->next;
-            }
-        }
+CustomJACKLexer::CustomJACKLexer(std::string file_name, bool streaming) : file_name(file_name), streaming(streaming), buffer_mask(streaming ? STREAM_BUFFER_SIZE - 1 : SIZE_MAX), next_token(0), token_count(0) {
+    if(!input.open(file_name)) {
+        throw FileNotFoundException("Unable to open " + file_name);
     }
-}
 
-GeneratedParser::LexerToken& CustomJACKLexer::get_next_token() {
-    CustomLexerToken* old_next = next_token;
-    if (next_token != nullptr) {
-        next_token = next_token->next;
-        return *old_next;
+    scan_position = input.begin();
+    line_number = 1;
+    line_start = scan_position;
+
+    if(streaming) {
+        tokens.reserve(STREAM_BUFFER_SIZE);
+    } else {
+        scan_tokens(false);
     }
-    return *token_list_tail;
 }
 
-GeneratedParser::LexerToken& CustomJACKLexer::peak_next_token() {
-    return *next_token;
-}
+CustomJACKLexer::~CustomJACKLexer() {}
 
-void CustomJACKLexer::scan_file() {
-    std::fstream file(file_name, std::fstream::in);
+void CustomJACKLexer::rewind() {
+    next_token = 0;
 
-    if(!file.is_open()) {
-        throw FileNotFoundException("Unable to open " + file_name);
+    if(streaming) {
+        tokens.clear();
+        token_count = 0;
+        scan_position = input.begin();
+        line_number = 1;
+        line_start = scan_position;
     }
+}
 
-    char c;
-    std::string buffer;
-    int lineNumber = 1;
-    int charPos = 0;
+void CustomJACKLexer::scan_tokens(bool oneToken) {
+    // The input is followed by a '\0' sentinel, so looking one character ahead needs no check of the end
+    const char* pos = scan_position;
+    const char* end = input.end();
+    int lineNumber = line_number;
+    // Start of the current line, so the position of a character is found without counting every character
+    const char* lineStart = line_start;
+    size_t firstToken = token_count;
+
+    // Move past any line feeds in [from, to)
+    auto countLines = [&](const char* from, const char* to) {
+        const char* lastLineFeed = nullptr;
+        size_t lines = TextScan::count_lines(from, to, lastLineFeed);
+
+        if(lines > 0) {
+            lineNumber += lines;
+            lineStart = lastLineFeed + 1;
+        }
+    };
 
-    while(file.get(c)) {
-        charPos++;
+    while(pos < end && (!oneToken || token_count == firstToken)) {
+        char c = *pos;
+        int charPos = pos - lineStart + 1;
 
         // Check if character is whitespace
-        if(c == ' ' || c == '\t' || c == '\r') {
-            continue;
-        } else if(c == '\n') {
-            lineNumber++;
-            charPos = 0;
+        if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            const char* next = TextScan::skip_whitespace(pos + 1, end);
+            countLines(pos, next);
+            pos = next;
         }
 
         // Check if character is a comment
-         else if(c == '/') {
-            char c2 = file.peek();
+        else if(c == '/') {
+            char c2 = pos[1];
 
             if(c2 == '/') {
                 // Single line comment
-                while(file.get(c2)) {
-                    charPos++;
-
-                    if(c2 == '\n') {
-                        lineNumber++;
-                        charPos = 0;
-                        break;
-                    }
+                const char* lineFeed = TextScan::find_char(pos + 2, end, '\n');
+
+                if(lineFeed < end) {
+                    lineNumber++;
+                    lineStart = lineFeed + 1;
+                    pos = lineFeed + 1;
+                } else {
+                    pos = end;
                 }
-                continue;
             } else if(c2 == '*') {
-                // Multi-line comment
-                while(file.get(c2)) {
-                    charPos++;
-
-                    if(c2 == '*') {
-                        file.get(c2);
-                        charPos++;
-
-                        if(c2 == '/') {
-                            // End of comment
-                            break;
-                        }
-                    } else if(c2 == '\n') {
-                        lineNumber++;
-                        charPos = 0;
-                    }
+                // Multi-line comment, starting after the /*
+                const char* star = TextScan::find_char(pos + 2, end, '*');
+
+                while(star < end && star[1] != '/') {
+                    star = TextScan::find_char(star + 1, end, '*');
                 }
-                continue;
+
+                const char* next = star < end ? star + 2 : end;
+                countLines(pos, next);
+                pos = next;
             } else {
                 // A random / symbol
-                buffer += c;
-                add_new_token(buffer, "MATH_OPERATOR_SYMBOL", lineNumber, charPos);
-                buffer.clear();
-                continue;
+                add_new_token(TK_SLASH, std::string_view(pos, 1), "MATH_OPERATOR_SYMBOL", lineNumber, charPos);
+                pos++;
             }
         }
 
         // Check if character is a "
         else if(c == '"') {
-            int startingLineNumber = lineNumber;
-            int startingCharPos = charPos;
+            const char* close = TextScan::find_char(pos + 1, end, '"');
 
-            while(file.get(c)) {
-                charPos++;
-
-                if(c == '"') {
-                    break;
-                } else if(c == '\n') {
-                    lineNumber++;
-                    charPos = 0;
-                }
-                buffer += c;
-            }
-
-            if(file.eof()) {
+            if(close == end) {
                 // Unexpected end of file
-                // "(" + filename + ") line:" + std::to_string(lineNumber) + " pos:" + std::to_string(startingCharacterPosition)
-                throw UnexpectedEndOfFileException("(" + file_name + ") line:" + std::to_string(startingLineNumber) + " pos:" + std::to_string(startingCharPos) + " Lexer error: Unexpected end of file while scanning string");
-            } else {
-                add_new_token(buffer, "STRING_LITERAL", startingLineNumber, startingCharPos);
-                buffer.clear();
+                throw UnexpectedEndOfFileException("(" + file_name + ") line:" + std::to_string(lineNumber) + " pos:" + std::to_string(charPos) + " Lexer error: Unexpected end of file while scanning string");
             }
 
-            continue;
+            add_new_token(TK_STRING_LITERAL, std::string_view(pos + 1, close - pos - 1), "STRING_LITERAL", lineNumber, charPos);
+            countLines(pos + 1, close);
+            pos = close + 1;
         }
 
         // Check if character is a letter or _ (start of identifier or keyword)
-        else if(isalpha(c) || c == '_') {
-            buffer += c;
+        else if(isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const char* start = pos++;
 
-            int c2 = file.peek();
-            int startingCharPos = charPos;
-
-            while(isdigit(c2) || isalpha(c2) || c2 == '_') {
-                file.get(c);
-                charPos++;
-                buffer += c;
-                c2 = file.peek();
+            // The sentinel ends the loop at the end of the input
+            while(isalnum(static_cast<unsigned char>(*pos)) || *pos == '_') {
+                pos++;
             }
 
-            add_new_token(buffer, get_keyword_type(buffer), lineNumber, startingCharPos);
-            buffer.clear();
+            // One hash and one comparison tell a keyword from an identifier
+            std::string_view lexeme(start, pos - start);
+            TokenKind kind = classify_lexeme(lexeme);
+            add_new_token(kind == TK_UNKNOWN ? TK_IDENTIFIER : kind, lexeme, get_keyword_type(kind), lineNumber, charPos);
         }
 
         // Check if character is a digit
-        else if(isdigit(c)) {
-            buffer += c;
-
-            int c2 = file.peek();
-            int startingCharPos = charPos;
+        else if(isdigit(static_cast<unsigned char>(c))) {
+            const char* start = pos++;
 
-            while(isdigit(c2)) {
-                file.get(c);
-                charPos++;
-                buffer += c;
-                c2 = file.peek();
+            while(isdigit(static_cast<unsigned char>(*pos))) {
+                pos++;
             }
 
-            add_new_token(buffer, "NUMERIC_CONSTANT", lineNumber, startingCharPos);
-            buffer.clear();
+            add_new_token(TK_NUMERIC_CONSTANT, std::string_view(start, pos - start), "NUMERIC_CONSTANT", lineNumber, charPos);
         }
 
         // Character is a symbol
         else if(c == '(' || c == ')' || c == '[' || c ==']' || c == '{' || c =='}') {
-            buffer += c;
-            add_new_token(buffer, "BRACKET_SYMBOL", lineNumber, charPos);
-            buffer.clear();
+            std::string_view symbol(pos++, 1);
+            add_new_token(classify_lexeme(symbol), symbol, "BRACKET_SYMBOL", lineNumber, charPos);
         } else if(c == ',') {
-            buffer += c;
-            add_new_token(buffer, "LIST_SEPERATOR_SYMBOL", lineNumber, charPos);
-            buffer.clear();
+            std::string_view symbol(pos++, 1);
+            add_new_token(classify_lexeme(symbol), symbol, "LIST_SEPERATOR_SYMBOL", lineNumber, charPos);
         } else if(c == ';') {
-            buffer += c;
-            add_new_token(buffer, "STATEMENT_TERMINATE_SYMBOL", lineNumber, charPos);
-            buffer.clear();
+            std::string_view symbol(pos++, 1);
+            add_new_token(classify_lexeme(symbol), symbol, "STATEMENT_TERMINATE_SYMBOL", lineNumber, charPos);
         } else if(c == '=') {
-            buffer += c;
-            add_new_token(buffer, "ASSIGN_COMP_OPERATOR_SYMBOL", lineNumber, charPos);
-            buffer.clear();
+            std::string_view symbol(pos++, 1);
+            add_new_token(classify_lexeme(symbol), symbol, "ASSIGN_COMP_OPERATOR_SYMBOL", lineNumber, charPos);
         } else if(c == '.') {
-            buffer += c;
-            add_new_token(buffer, "CLASS_MEMBER_SYMBOL", lineNumber, charPos);
-            buffer.clear();
+            std::string_view symbol(pos++, 1);
+            add_new_token(classify_lexeme(symbol), symbol, "CLASS_MEMBER_SYMBOL", lineNumber, charPos);
         } else if(c == '+' || c == '-' || c == '*' || c == '/') {
-            buffer += c;
-            add_new_token(buffer, "MATH_OPERATOR_SYMBOL", lineNumber, charPos);
-            buffer.clear();
+            std::string_view symbol(pos++, 1);
+            add_new_token(classify_lexeme(symbol), symbol, "MATH_OPERATOR_SYMBOL", lineNumber, charPos);
         } else if(c == '&' || c == '|' || c == '~' || c == '<' || c == '>') {
-            buffer += c;
-            add_new_token(buffer, "LOGIC_OPERATOR_SYMBOL", lineNumber, charPos);
-            buffer.clear();
+            std::string_view symbol(pos++, 1);
+            add_new_token(classify_lexeme(symbol), symbol, "LOGIC_OPERATOR_SYMBOL", lineNumber, charPos);
         }
 
         // Unknown symbol
@@ -218,66 +181,411 @@ void CustomJACKLexer::scan_file() {
         }
     }
 
-    add_new_token("", "EOF", lineNumber, charPos);
+    // A streaming lexer which has just added a token leaves EOF to the next call
+    if(!oneToken || token_count == firstToken) {
+        add_new_token(TK_EOF, "", "EOF", lineNumber, end - lineStart);
+    }
 
-    file.close();
+    scan_position = pos;
+    line_number = lineNumber;
+    line_start = lineStart;
 }
 
-void CustomJACKLexer::add_new_token(std::string lexeme, std::string type, int lineNumber, int startingCharPos) {
-    CustomLexerToken* new_token = new CustomLexerToken(lexeme, type, lineNumber, startingCharPos, file_name);
-
-    // Add new token to the list of tokens
-    if(token_list_head == nullptr) {
-        token_list_head = new_token;
-        token_list_tail = new_token;
-        next_token = new_token;
+void CustomJACKLexer::add_new_token(TokenKind kind, std::string_view lexeme, std::string_view type, int lineNumber, int startingCharPos) {
+    // Once the ring buffer is full each token replaces the oldest
+    if(tokens.size() > buffer_mask) {
+        tokens[token_count & buffer_mask] = LexerToken(kind, lexeme, type, lineNumber, startingCharPos, file_name);
     } else {
-        new_token->prev = token_list_tail;
-        token_list_tail->next = new_token;
-        token_list_tail = new_token;
+        tokens.emplace_back(kind, lexeme, type, lineNumber, startingCharPos, file_name);
     }
+
+    token_count++;
 }
 
-std::string CustomJACKLexer::get_keyword_type(std::string lexeme) {
-    if(std::find(std::begin(constructKeywords), std::end(constructKeywords),
-        lexeme) != std::end(constructKeywords)) {
-        return "CONSTRUCT_STATEMENT";
-    } else if(std::find(std::begin(typeKeywords), std::end(typeKeywords),
-        lexeme) != std::end(typeKeywords)) {
-        return "TYPE_STATEMENT";
-    } else if(std::find(std::begin(variableKeywords), std::end(variableKeywords),
-        lexeme) != std::end(variableKeywords)) {
-        return "VARIABLE_STATEMENT";
-    } else if(std::find(std::begin(controlKeywords), std::end(controlKeywords),
-        lexeme) != std::end(controlKeywords)) {
-        return "CONTROL_STATEMENT";
-    } else if(std::find(std::begin(referenceKeywords), std::end(referenceKeywords),
-        lexeme) != std::end(referenceKeywords)) {
-        return "THIS_REFERENCE";
-    } else if(std::find(std::begin(valueKeywords), std::end(valueKeywords),
-        lexeme) != std::end(valueKeywords)) {
-        if(lexeme == "null") {
+std::string_view CustomJACKLexer::get_keyword_type(TokenKind kind) {
+    switch(kind) {
+        case TK_CLASS:
+        case TK_CONSTRUCTOR:
+        case TK_METHOD:
+        case TK_FUNCTION:
+            return "CONSTRUCT_STATEMENT";
+        case TK_INT:
+        case TK_BOOLEAN:
+        case TK_CHAR:
+        case TK_VOID:
+            return "TYPE_STATEMENT";
+        case TK_VAR:
+        case TK_LET:
+        case TK_STATIC:
+        case TK_FIELD:
+            return "VARIABLE_STATEMENT";
+        case TK_DO:
+        case TK_IF:
+        case TK_ELSE:
+        case TK_WHILE:
+        case TK_RETURN:
+            return "CONTROL_STATEMENT";
+        case TK_THIS:
+            return "THIS_REFERENCE";
+        case TK_NULL:
             return "NULL_CONSTANT";
-        } else {
+        case TK_TRUE:
+        case TK_FALSE:
             return "BOOLEAN_CONSTANT";
+        default:
+            return "IDENTIFIER";
+    }
+}
+
+#ifdef GENERATED_PARSER_EVENTS
+CountingEventHandler::CountingEventHandler() : nonterminal_count(0), token_count(0), depth(0), max_depth(0) {}
+
+void CountingEventHandler::enter(GeneratedParser::NonterminalKind) {
+    nonterminal_count++;
+    depth++;
+    max_depth = std::max(depth, max_depth);
+}
+
+void CountingEventHandler::token(GeneratedParser::TokenKind, std::string_view) {
+    token_count++;
+}
+
+void CountingEventHandler::exit(GeneratedParser::NonterminalKind) {
+    depth--;
+}
+#endif
+
+// Parse each file repeatedly, timing only the parser. The files are lexed once beforehand
+int run_benchmark(int repetitions, const std::vector<std::string>& file_names) {
+    size_t token_count = 0;
+    double seconds = 0;
+
+    for (const std::string& file_name : file_names) {
+        CustomJACKLexer lexer(file_name);
+#ifdef GENERATED_PARSER_EVENTS
+        CountingEventHandler handler;
+        GeneratedParser::BasicJACKCompiler<CustomJACKLexer> parser(lexer, handler);
+#else
+        GeneratedParser::BasicJACKCompiler<CustomJACKLexer> parser(lexer);
+#endif
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < repetitions; i++) {
+            lexer.rewind();
+            parser.start_parsing();
+        }
+
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        token_count += lexer.get_token_count() * repetitions;
+    }
+
+    std::cout << "Parsed " << token_count << " tokens in " << seconds << "s (" << token_count / seconds << " tokens/s)" << std::endl;
+
+    return 0;
+}
+
+// Lex each file repeatedly with every scanning implementation the processor supports, after checking that each finds
+// the same tokens as the scalar one
+int run_scan_benchmark(int repetitions, const std::vector<std::string>& file_names) {
+    TextScan::Implementation best = TextScan::get_best_implementation();
+
+    for (int implementation = TextScan::SCALAR; implementation <= best; implementation++) {
+        size_t token_count = 0;
+        double seconds = 0;
+
+        for (const std::string& file_name : file_names) {
+            TextScan::set_implementation(TextScan::SCALAR);
+            CustomJACKLexer scalar_lexer(file_name);
+            TextScan::set_implementation(static_cast<TextScan::Implementation>(implementation));
+            CustomJACKLexer lexer(file_name);
+
+            for (size_t i = 0; i < scalar_lexer.get_token_count(); i++) {
+                const GeneratedParser::LexerToken& scalar_token = scalar_lexer.get_next_token();
+                const GeneratedParser::LexerToken& token = lexer.get_next_token();
+
+                if (scalar_token.get_kind() != token.get_kind() || scalar_token.get_lexeme() != token.get_lexeme() || scalar_token.get_line_number() != token.get_line_number() || scalar_token.get_char_position() != token.get_char_position()) {
+                    std::cout << file_name << ": " << TextScan::get_implementation_name(static_cast<TextScan::Implementation>(implementation)) << " differs from scalar at line " << scalar_token.get_line_number() << ":" << scalar_token.get_char_position() << std::endl;
+                    return -1;
+                }
+            }
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < repetitions; i++) {
+                CustomJACKLexer repeated_lexer(file_name);
+            }
+
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            token_count += lexer.get_token_count() * repetitions;
         }
+
+        std::cout << TextScan::get_implementation_name(static_cast<TextScan::Implementation>(implementation)) << ": " << token_count << " tokens in " << seconds << "s (" << token_count / seconds << " tokens/s)" << std::endl;
     }
-    return "IDENTIFIER";
+
+    TextScan::set_implementation(best);
+
+    return 0;
+}
+
+#ifdef GENERATED_PARSER_DFA_LEXER
+// Lex each file repeatedly with CustomJACKLexer and with the generated DFALexer, after checking they find the same tokens
+int run_lexer_benchmark(int repetitions, const std::vector<std::string>& file_names) {
+    size_t token_count = 0;
+    double custom_seconds = 0;
+    double dfa_seconds = 0;
+
+    for (const std::string& file_name : file_names) {
+        CustomJACKLexer custom_lexer(file_name);
+        GeneratedParser::DFALexer dfa_lexer(file_name);
+
+        for (size_t i = 0; i < custom_lexer.get_token_count(); i++) {
+            const GeneratedParser::LexerToken& custom_token = custom_lexer.get_next_token();
+            const GeneratedParser::LexerToken& dfa_token = dfa_lexer.get_next_token();
+
+            if (custom_token.get_kind() != dfa_token.get_kind() || custom_token.get_lexeme() != dfa_token.get_lexeme() || custom_token.get_line_number() != dfa_token.get_line_number() || custom_token.get_char_position() != dfa_token.get_char_position()) {
+                std::cout << file_name << ": lexers differ at line " << custom_token.get_line_number() << ":" << custom_token.get_char_position() << ", `" << custom_token.get_lexeme() << "` and line " << dfa_token.get_line_number() << ":" << dfa_token.get_char_position() << ", `" << dfa_token.get_lexeme() << "`" << std::endl;
+                return -1;
+            }
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < repetitions; i++) {
+            CustomJACKLexer lexer(file_name);
+        }
+
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < repetitions; i++) {
+            GeneratedParser::DFALexer lexer(file_name);
+        }
+
+        custom_seconds += std::chrono::duration<double>(middle - start).count();
+        dfa_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - middle).count();
+        token_count += custom_lexer.get_token_count() * repetitions;
+    }
+
+    std::cout << "CustomJACKLexer: " << token_count << " tokens in " << custom_seconds << "s (" << token_count / custom_seconds << " tokens/s)" << std::endl;
+    std::cout << "DFALexer: " << token_count << " tokens in " << dfa_seconds << "s (" << token_count / dfa_seconds << " tokens/s)" << std::endl;
+
+    return 0;
+}
+#endif
+
+// Lex and parse each file repeatedly, with the whole file lexed first and then with a streaming lexer
+int run_stream_benchmark(int repetitions, const std::vector<std::string>& file_names) {
+    const char* names[] = {"Whole file", "Streaming"};
+
+    for (int streaming = 0; streaming <= 1; streaming++) {
+        size_t token_count = 0;
+        size_t buffered_token_count = 0;
+        double seconds = 0;
+
+        for (const std::string& file_name : file_names) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < repetitions; i++) {
+                CustomJACKLexer lexer(file_name, streaming);
+#ifdef GENERATED_PARSER_EVENTS
+                CountingEventHandler handler;
+                GeneratedParser::BasicJACKCompiler<CustomJACKLexer> parser(lexer, handler);
+#else
+                GeneratedParser::BasicJACKCompiler<CustomJACKLexer> parser(lexer);
+#endif
+                parser.start_parsing();
+                token_count += lexer.get_token_count();
+                buffered_token_count = std::max(buffered_token_count, lexer.get_buffered_token_count());
+            }
+
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::cout << names[streaming] << ": " << token_count << " tokens in " << seconds << "s (" << token_count / seconds << " tokens/s), at most " << buffered_token_count << " tokens in memory" << std::endl;
+    }
+
+    return 0;
+}
+
+#if defined(GENERATED_PARSER_INCREMENTAL) && defined(GENERATED_PARSER_DFA_LEXER)
+// Read a file written by parse_tree_gnu_plot()
+static std::string read_tree_file(const std::string& file_name) {
+    std::ifstream file(file_name);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Add a character to an identifier half way through each file and take it away again, reparsing after each edit. The
+// reparsed tree is checked against parsing the edited text from scratch, then the edits are timed against full parses
+int run_incremental_benchmark(int repetitions, const std::vector<std::string>& file_names) {
+    size_t token_count = 0;
+    size_t reparsed_token_count = 0;
+    double incremental_seconds = 0;
+    double full_seconds = 0;
+
+    for (const std::string& file_name : file_names) {
+        DFALexer lexer(file_name);
+        BasicJACKCompiler<DFALexer> parser(lexer);
+        parser.start_parsing();
+
+        size_t token_index = lexer.get_token_count() / 2;
+        lexer.seek_token(token_index);
+
+        while (lexer.peak_next_token().get_kind() != TK_IDENTIFIER && lexer.peak_next_token().get_kind() != TK_EOF) {
+            lexer.get_next_token();
+        }
+
+        std::string_view identifier = lexer.peak_next_token().get_lexeme();
+
+        if (identifier.empty()) {
+            std::cout << file_name << ": no identifier to edit" << std::endl;
+            continue;
+        }
+
+        size_t offset = identifier.data() - lexer.get_text().data() + identifier.size();
+
+        parser.reparse({lexer.edit_text(offset, 0, "x")});
+        parser.parse_tree_gnu_plot("incremental-tree.out");
+
+        std::string edited_text(lexer.get_text());
+        DFALexer full_lexer(edited_text, file_name);
+        BasicJACKCompiler<DFALexer> full_parser(full_lexer);
+        full_parser.start_parsing();
+        full_parser.parse_tree_gnu_plot("full-tree.out");
+
+        if (read_tree_file("incremental-tree.out") != read_tree_file("full-tree.out")) {
+            std::cout << file_name << ": reparsed tree differs from parsing the edited file" << std::endl;
+            return -1;
+        }
+
+        parser.reparse({lexer.edit_text(offset, 1, "")});
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < repetitions; i++) {
+            reparsed_token_count += parser.reparse({lexer.edit_text(offset, 0, "x")});
+            reparsed_token_count += parser.reparse({lexer.edit_text(offset, 1, "")});
+        }
+
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < repetitions * 2; i++) {
+            DFALexer repeated_lexer(lexer.get_text(), file_name);
+            BasicJACKCompiler<DFALexer> repeated_parser(repeated_lexer);
+            repeated_parser.start_parsing();
+        }
+
+        incremental_seconds += std::chrono::duration<double>(middle - start).count();
+        full_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - middle).count();
+        token_count += lexer.get_token_count() * repetitions * 2;
+    }
+
+    std::remove("incremental-tree.out");
+    std::remove("full-tree.out");
+
+    std::cout << "Full parse: " << token_count << " tokens in " << full_seconds << "s (" << token_count / full_seconds << " tokens/s)" << std::endl;
+    std::cout << "Reparse: " << reparsed_token_count << " tokens parsed again in " << incremental_seconds << "s, " << full_seconds / incremental_seconds << " times faster" << std::endl;
+
+    return 0;
+}
+#endif
+
+// Lex and parse every file at once on a number of threads, then report each file in the order given
+int run_parallel(unsigned int thread_count, const std::vector<std::string>& file_names) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef GENERATED_PARSER_EVENTS
+    auto results = GeneratedParser::parse_files<CustomJACKLexer, CountingEventHandler>(file_names, thread_count);
+#else
+    auto results = GeneratedParser::parse_files<CustomJACKLexer>(file_names, thread_count);
+#endif
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t token_count = 0;
+    int failed = 0;
+
+    for (const auto& result : results) {
+        if (result.error != "") {
+            std::cout << result.file_name << ": " << result.error << std::endl;
+            failed++;
+            continue;
+        }
+
+        token_count += result.lexer->get_token_count();
+#ifdef GENERATED_PARSER_ERROR_RECOVERY
+        for (const GeneratedParser::ParseDiagnostic& diagnostic : result.parser->get_diagnostics()) {
+            std::cout << result.file_name << ": " << diagnostic.get_message() << std::endl;
+        }
+#endif
+    }
+
+    std::cout << "Parsed " << results.size() - failed << " of " << results.size() << " files (" << token_count << " tokens) in " << seconds << "s" << std::endl;
+
+    return failed == 0 ? 0 : -1;
 }
 
 int main(int argc, const char* argv[]) {
 
-    if (argc != 2) {
+    if (argc >= 4 && std::string(argv[1]) == "--benchmark") {
+        return run_benchmark(std::stoi(argv[2]), std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    if (argc >= 4 && std::string(argv[1]) == "--scan-benchmark") {
+        return run_scan_benchmark(std::stoi(argv[2]), std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    if (argc >= 4 && std::string(argv[1]) == "--parallel") {
+        return run_parallel(std::stoi(argv[2]), std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    if (argc >= 4 && std::string(argv[1]) == "--stream-benchmark") {
+        return run_stream_benchmark(std::stoi(argv[2]), std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+#ifdef GENERATED_PARSER_DFA_LEXER
+    if (argc >= 4 && std::string(argv[1]) == "--lexer-benchmark") {
+        return run_lexer_benchmark(std::stoi(argv[2]), std::vector<std::string>(argv + 3, argv + argc));
+    }
+#endif
+
+#if defined(GENERATED_PARSER_INCREMENTAL) && defined(GENERATED_PARSER_DFA_LEXER)
+    if (argc >= 4 && std::string(argv[1]) == "--incremental-benchmark") {
+        return run_incremental_benchmark(std::stoi(argv[2]), std::vector<std::string>(argv + 3, argv + argc));
+    }
+#endif
+
+    // Lex the file as it is parsed rather than all at once
+    bool streaming = argc == 3 && std::string(argv[1]) == "--stream";
+
+    if (argc != 2 && !streaming) {
         std::cout << "Incorrect usage. Expected 1 parameter" << std::endl;
         return -1;
     }
 
-    CustomJACKLexer lexer(argv[1]);
-    GeneratedParser::JACKCompiler parser(lexer);
+    CustomJACKLexer lexer(argv[argc - 1], streaming);
+#ifdef GENERATED_PARSER_EVENTS
+    CountingEventHandler handler;
+    GeneratedParser::BasicJACKCompiler<CustomJACKLexer> parser(lexer, handler);
+#else
+    GeneratedParser::BasicJACKCompiler<CustomJACKLexer> parser(lexer);
+#endif
     std::cout << "Starting parsing" << std::endl;
     parser.start_parsing();
+#ifdef GENERATED_PARSER_ERROR_RECOVERY
+    for (const GeneratedParser::ParseDiagnostic& diagnostic : parser.get_diagnostics()) {
+        std::cout << diagnostic.get_message() << std::endl;
+    }
+#endif
+#ifdef GENERATED_PARSER_EVENTS
+    std::cout << "Parsed " << handler.nonterminal_count << " nonterminals and " << handler.token_count << " tokens, nested " << handler.max_depth << " deep" << std::endl;
+#else
+#ifdef GENERATED_PARSER_FLAT_TREE
+    std::cout << "Parse tree has " << parser.get_flat_tree().size() << " nodes" << std::endl;
+#else
+    const GeneratedParser::ParseTreeArena& tree_arena = parser.get_tree_arena();
+    std::cout << "Parse tree has " << tree_arena.get_node_count() << " nodes using " << tree_arena.get_bytes_used() << " bytes in " << tree_arena.get_block_count() << " blocks" << std::endl;
+#endif
     std::cout << "Done parsing. Outputting parse tree to file for use with GNUPlot" << std::endl;
     parser.parse_tree_gnu_plot();
+#endif
 
     return 0;
 }
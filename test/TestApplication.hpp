@@ -1,46 +1,103 @@
 #ifndef __TEST_APP__
 #define __TEST_APP__
 
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "JACKCompiler.hpp"
+#include "TextScan.hpp"
 
-class CustomLexerToken : public GeneratedParser::LexerToken {
+// The parser is compiled for this class directly, so it is final and the token functions are defined here to be inlined
+// The whole file is lexed when the lexer is constructed, unless it is streaming. A streaming lexer only lexes as far as
+// the parser has read, into a ring buffer of the latest tokens, so the memory used for tokens does not grow with the file
+class CustomJACKLexer final : public GeneratedParser::VirtualLexer {
 public:
-        CustomLexerToken(std::string lexeme, std::string token_type, int line_number, int char_position, std::string file_name) : LexerToken(lexeme, token_type, line_number, char_position, file_name), next(nullptr), prev(nullptr) {}
-        ~CustomLexerToken() {}
+    // Tokens kept by a streaming lexer. A power of two, and more than the two an LL(1) parser holds at once
+    static const size_t STREAM_BUFFER_SIZE = 4;
 
-        CustomLexerToken* next;
-        CustomLexerToken* prev;
-};
-
-class CustomJACKLexer : public GeneratedParser::VirtualLexer {
-public:
-    CustomJACKLexer(std::string file_name);
+    CustomJACKLexer(std::string file_name, bool streaming = false);
     ~CustomJACKLexer();
 
-    GeneratedParser::LexerToken& get_next_token();
-    GeneratedParser::LexerToken& peak_next_token();
+    const GeneratedParser::LexerToken& get_next_token() {
+        const GeneratedParser::LexerToken& token = peak_next_token();
+
+        // Keep returning the EOF token once the end is reached
+        if (token.get_kind() != GeneratedParser::TK_EOF) {
+            next_token++;
+        }
+        return token;
+    }
+
+    const GeneratedParser::LexerToken& peak_next_token() {
+        // Only a streaming lexer runs out of tokens before EOF
+        if (next_token == token_count) {
+            scan_tokens(true);
+        }
+        return tokens[next_token & buffer_mask];
+    }
+
+    // Go back to the first token, so the same tokens can be parsed again. A streaming lexer lexes the file again
+    void rewind();
+
+    // Moving between tokens is for an incremental parser, and only works when not streaming
+    size_t get_token_index() const {
+        return next_token;
+    }
+
+    void seek_token(size_t token_index) {
+        next_token = token_index;
+    }
+
+    // Tokens lexed so far, which is all of them unless streaming
+    size_t get_token_count() const {
+        return token_count;
+    }
+
+    // Tokens held in memory
+    size_t get_buffered_token_count() const {
+        return tokens.size();
+    }
 
 private:
     std::string file_name;
-    CustomLexerToken* token_list_head;
-    CustomLexerToken* token_list_tail;
-    CustomLexerToken* next_token;
-
-    void scan_file();
-    void add_new_token(std::string lexeme, std::string type, int lineNumber, int startingCharPos);
-    std::string get_keyword_type(std::string lexeme);
-
-    // Store JACK keywords in lists
-    const static std::vector<std::string> constructKeywords;
-    const static std::vector<std::string> typeKeywords;
-    const static std::vector<std::string> variableKeywords;
-    const static std::vector<std::string> controlKeywords;
-    const static std::vector<std::string> referenceKeywords;
-    const static std::vector<std::string> valueKeywords;
+    // The whole file, memory mapped where possible. The lexemes of the tokens are views into it
+    InputFile input;
+    bool streaming;
+    std::vector<GeneratedParser::LexerToken> tokens;
+    // A token is stored at its number masked with this, which keeps every token unless streaming
+    size_t buffer_mask;
+    size_t next_token;
+    size_t token_count;
+    // Where lexing carries on from
+    const char* scan_position;
+    int line_number;
+    const char* line_start;
+
+    // Lex until one token has been added, or otherwise to the end of the file. The last token is EOF
+    void scan_tokens(bool oneToken);
+    void add_new_token(GeneratedParser::TokenKind kind, std::string_view lexeme, std::string_view type, int lineNumber, int startingCharPos);
+    // Token type of a keyword, or IDENTIFIER for any other kind
+    std::string_view get_keyword_type(GeneratedParser::TokenKind kind);
+};
+
+#ifdef GENERATED_PARSER_EVENTS
+// Counts what the parser recognises without keeping any of it
+class CountingEventHandler : public GeneratedParser::ParseEventHandler {
+public:
+    CountingEventHandler();
+
+    void enter(GeneratedParser::NonterminalKind nonterminal);
+    void token(GeneratedParser::TokenKind kind, std::string_view lexeme);
+    void exit(GeneratedParser::NonterminalKind nonterminal);
+
+    size_t nonterminal_count;
+    size_t token_count;
+    int depth;
+    int max_depth;
 };
+#endif
 
 // Error classes
 
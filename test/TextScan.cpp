@@ -0,0 +1,338 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "TextScan.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TEXT_SCAN_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// SSE2 is part of x86-64. AVX2 functions are compiled with a target attribute and only called if the processor has it
+#if defined(__x86_64__) || defined(_M_X64)
+#define TEXT_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(TEXT_SCAN_SSE2) && defined(__GNUC__)
+#define TEXT_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+/*
+ * InputFile Class
+ */
+
+InputFile::InputFile() : data(nullptr), length(0), mapping(nullptr) {}
+
+InputFile::~InputFile() {
+#ifdef TEXT_SCAN_MMAP
+    if (mapping != nullptr) {
+        munmap(mapping, length);
+    }
+#endif
+}
+
+bool InputFile::open(const std::string& file_name) {
+#ifdef TEXT_SCAN_MMAP
+    int file = ::open(file_name.c_str(), O_RDONLY);
+
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat file_status;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+
+    // The rest of the last page reads as zeros, which is the sentinel, so a file ending on a page boundary is read instead
+    if (fstat(file, &file_status) == 0 && file_status.st_size > 0 && file_status.st_size % page_size != 0) {
+        void* address = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (address != MAP_FAILED) {
+            close(file);
+            mapping = address;
+            data = static_cast<const char*>(address);
+            length = file_status.st_size;
+            return true;
+        }
+    }
+
+    close(file);
+#endif
+
+    std::ifstream file_stream(file_name, std::ifstream::in | std::ifstream::binary);
+
+    if (!file_stream.is_open()) {
+        return false;
+    }
+
+    // std::string always has a '\0' after its contents
+    buffer.assign(std::istreambuf_iterator<char>(file_stream), std::istreambuf_iterator<char>());
+    data = buffer.c_str();
+    length = buffer.size();
+
+    return true;
+}
+
+const char* InputFile::begin() const { return data; }
+
+const char* InputFile::end() const { return data + length; }
+
+size_t InputFile::size() const { return length; }
+
+bool InputFile::is_mapped() const { return mapping != nullptr; }
+
+/*
+ * TextScan Functions
+ */
+
+namespace {
+    inline bool is_whitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    const char* skip_whitespace_scalar(const char* begin, const char* end) {
+        while (begin < end && is_whitespace(*begin)) {
+            begin++;
+        }
+
+        return begin;
+    }
+
+    const char* find_char_scalar(const char* begin, const char* end, char c) {
+        while (begin < end && *begin != c) {
+            begin++;
+        }
+
+        return begin;
+    }
+
+    size_t count_lines_scalar(const char* begin, const char* end, const char*& last_line_feed) {
+        size_t count = 0;
+
+        for (const char* p = begin; p < end; p++) {
+            if (*p == '\n') {
+                count++;
+                last_line_feed = p;
+            }
+        }
+
+        return count;
+    }
+
+#ifdef TEXT_SCAN_SSE2
+    inline int lowest_bit(unsigned int mask) {
+#ifdef __GNUC__
+        return __builtin_ctz(mask);
+#else
+        int bit = 0;
+        while ((mask & 1) == 0) {
+            mask >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    inline int highest_bit(unsigned int mask) {
+#ifdef __GNUC__
+        return 31 - __builtin_clz(mask);
+#else
+        int bit = 31;
+        while ((mask & 0x80000000u) == 0) {
+            mask <<= 1;
+            bit--;
+        }
+        return bit;
+#endif
+    }
+
+    inline int bit_count(unsigned int mask) {
+#ifdef __GNUC__
+        return __builtin_popcount(mask);
+#else
+        int count = 0;
+        for (; mask != 0; mask &= mask - 1) {
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    // Mask with a bit set for each of the 16 bytes which is whitespace
+    inline unsigned int whitespace_mask_sse2(__m128i bytes) {
+        __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+                                       _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))));
+        return _mm_movemask_epi8(matches);
+    }
+
+    const char* skip_whitespace_sse2(const char* begin, const char* end) {
+        for (; end - begin >= 16; begin += 16) {
+            unsigned int mask = ~whitespace_mask_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin))) & 0xFFFF;
+
+            if (mask != 0) {
+                return begin + lowest_bit(mask);
+            }
+        }
+
+        return skip_whitespace_scalar(begin, end);
+    }
+
+    const char* find_char_sse2(const char* begin, const char* end, char c) {
+        __m128i target = _mm_set1_epi8(c);
+
+        for (; end - begin >= 16; begin += 16) {
+            unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)), target));
+
+            if (mask != 0) {
+                return begin + lowest_bit(mask);
+            }
+        }
+
+        return find_char_scalar(begin, end, c);
+    }
+
+    size_t count_lines_sse2(const char* begin, const char* end, const char*& last_line_feed) {
+        __m128i line_feed = _mm_set1_epi8('\n');
+        size_t count = 0;
+
+        for (; end - begin >= 16; begin += 16) {
+            unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)), line_feed));
+
+            if (mask != 0) {
+                count += bit_count(mask);
+                last_line_feed = begin + highest_bit(mask);
+            }
+        }
+
+        return count + count_lines_scalar(begin, end, last_line_feed);
+    }
+#endif
+
+#ifdef TEXT_SCAN_AVX2
+    __attribute__((target("avx2"))) inline unsigned int whitespace_mask_avx2(__m256i bytes) {
+        __m256i matches = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))),
+                                          _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))));
+        return _mm256_movemask_epi8(matches);
+    }
+
+    __attribute__((target("avx2"))) const char* skip_whitespace_avx2(const char* begin, const char* end) {
+        for (; end - begin >= 32; begin += 32) {
+            unsigned int mask = ~whitespace_mask_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)));
+
+            if (mask != 0) {
+                return begin + lowest_bit(mask);
+            }
+        }
+
+        return skip_whitespace_sse2(begin, end);
+    }
+
+    __attribute__((target("avx2"))) const char* find_char_avx2(const char* begin, const char* end, char c) {
+        __m256i target = _mm256_set1_epi8(c);
+
+        for (; end - begin >= 32; begin += 32) {
+            unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)), target));
+
+            if (mask != 0) {
+                return begin + lowest_bit(mask);
+            }
+        }
+
+        return find_char_sse2(begin, end, c);
+    }
+
+    __attribute__((target("avx2"))) size_t count_lines_avx2(const char* begin, const char* end, const char*& last_line_feed) {
+        __m256i line_feed = _mm256_set1_epi8('\n');
+        size_t count = 0;
+
+        for (; end - begin >= 32; begin += 32) {
+            unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)), line_feed));
+
+            if (mask != 0) {
+                count += bit_count(mask);
+                last_line_feed = begin + highest_bit(mask);
+            }
+        }
+
+        return count + count_lines_sse2(begin, end, last_line_feed);
+    }
+#endif
+
+    TextScan::Implementation current_implementation = TextScan::get_best_implementation();
+} // namespace
+
+const char* TextScan::skip_whitespace(const char* begin, const char* end) {
+    switch (current_implementation) {
+#ifdef TEXT_SCAN_AVX2
+        case AVX2: return skip_whitespace_avx2(begin, end);
+#endif
+#ifdef TEXT_SCAN_SSE2
+        case SSE2: return skip_whitespace_sse2(begin, end);
+#endif
+        default: return skip_whitespace_scalar(begin, end);
+    }
+}
+
+const char* TextScan::find_char(const char* begin, const char* end, char c) {
+    switch (current_implementation) {
+#ifdef TEXT_SCAN_AVX2
+        case AVX2: return find_char_avx2(begin, end, c);
+#endif
+#ifdef TEXT_SCAN_SSE2
+        case SSE2: return find_char_sse2(begin, end, c);
+#endif
+        default: return find_char_scalar(begin, end, c);
+    }
+}
+
+size_t TextScan::count_lines(const char* begin, const char* end, const char*& last_line_feed) {
+    switch (current_implementation) {
+#ifdef TEXT_SCAN_AVX2
+        case AVX2: return count_lines_avx2(begin, end, last_line_feed);
+#endif
+#ifdef TEXT_SCAN_SSE2
+        case SSE2: return count_lines_sse2(begin, end, last_line_feed);
+#endif
+        default: return count_lines_scalar(begin, end, last_line_feed);
+    }
+}
+
+TextScan::Implementation TextScan::get_best_implementation() {
+#ifdef TEXT_SCAN_AVX2
+    // This can run while globals are being constructed, before the compiler's own setup of the processor checks
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+#endif
+#ifdef TEXT_SCAN_SSE2
+    return SSE2;
+#else
+    return SCALAR;
+#endif
+}
+
+TextScan::Implementation TextScan::get_implementation() { return current_implementation; }
+
+bool TextScan::set_implementation(Implementation implementation) {
+    if (implementation > get_best_implementation()) {
+        return false;
+    }
+
+    current_implementation = implementation;
+    return true;
+}
+
+const char* TextScan::get_implementation_name(Implementation implementation) {
+    switch (implementation) {
+        case AVX2: return "AVX2";
+        case SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
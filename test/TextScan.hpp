@@ -0,0 +1,59 @@
+#ifndef __TEXT_SCAN__
+#define __TEXT_SCAN__
+
+#include <cstddef>
+#include <string>
+
+// A whole file, memory mapped where the system allows it and read into memory otherwise. Either way the byte after
+// the end is a '\0' sentinel, so a scan can look one byte ahead without checking the length
+class InputFile {
+public:
+    InputFile();
+    ~InputFile();
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    // Returns false if the file cannot be read
+    bool open(const std::string& file_name);
+
+    const char* begin() const;
+    const char* end() const;
+    size_t size() const;
+    bool is_mapped() const;
+
+private:
+    const char* data;
+    size_t length;
+    // Set while the file is mapped, to be unmapped by the destructor
+    void* mapping;
+    // Used when the file cannot be mapped, or when it fills its last page and would have no sentinel
+    std::string buffer;
+};
+
+// Searches over a range of bytes, each with SSE2 and AVX2 versions for x86 chosen when the program starts. A scalar
+// version is used on other processors and for the bytes left at the end of a range. Every version gives the same result
+namespace TextScan {
+    enum Implementation {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    // First byte in [begin, end) which is not a space, tab, carriage return or line feed, otherwise end
+    const char* skip_whitespace(const char* begin, const char* end);
+    // First c in [begin, end), otherwise end
+    const char* find_char(const char* begin, const char* end, char c);
+    // Number of line feeds in [begin, end). If there are any, last_line_feed is set to the last one
+    size_t count_lines(const char* begin, const char* end, const char*& last_line_feed);
+
+    // The best implementation this processor supports
+    Implementation get_best_implementation();
+    Implementation get_implementation();
+    // Only for comparing implementations, and must not be called while another thread is scanning. Returns false if
+    // the processor does not support the implementation
+    bool set_implementation(Implementation implementation);
+    const char* get_implementation_name(Implementation implementation);
+} // namespace TextScan
+
+#endif